@@ -0,0 +1,230 @@
+#include <graphics/instance.hpp>
+#include <graphics/memory/vma.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Churn benchmark of the vma allocators on the first Vulkan device found.
+// Every case replays the same random mix of allocations and frees, with
+// --live allocations around once it got going, and reports the fastest of
+// a few runs as nanoseconds per operation. Pools are handed back to the
+// device between runs, so each run starts from empty heaps.
+//
+//   potato_vma_bench [--ops <n>] [--live <n>]
+//
+// The linear allocator searches a list per pool and replays a tenth of the
+// operations, or it would dominate the run time.
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    constexpr int repetitions = 5;
+
+    // a size to allocate, or the slot of a live allocation to free
+    struct op {
+        bool           alloc {};
+        vk::DeviceSize size {};
+        size_t         slot {};
+    };
+
+    std::vector<op> make_ops(size_t count, size_t live, bool pow2) {
+        std::mt19937_64 rng { 7 };
+        std::vector<op> ops {};
+        ops.reserve(count);
+
+        // fills up to `live` allocations, then frees a random one and
+        // allocates a new one in turns
+        size_t alive { 0 };
+        for ( size_t i = 0; i < count; ++i ) {
+            if ( alive < live ) {
+                // 4 KiB to 1 MiB in powers of two, or 1 B to 256 KiB
+                const vk::DeviceSize size {
+                    pow2 ? vk::DeviceSize(4096) << (rng() % 9)
+                         : 1 + rng() % (256 * 1024)
+                };
+                ops.push_back({ .alloc = true, .size = size });
+                ++alive;
+            }
+            else {
+                ops.push_back({ .alloc = false, .slot = rng() % alive });
+                --alive;
+            }
+        }
+
+        return ops;
+    }
+
+    // any memory type will do, find_mem_type picks the first device local
+    // one
+    constexpr uint32_t any_type { ~0u };
+
+    // runs ops on `allocator`, what is still allocated is left in `live`
+    template<typename A>
+    void replay(A&                                    allocator,
+                std::vector<typename A::suballoc_t*>& live,
+                const std::vector<op>&                ops) {
+        for ( const auto& o : ops ) {
+            if ( o.alloc ) {
+                live.push_back(allocator.allocate(
+                  { .size           = o.size,
+                    .alignment      = 256,
+                    .memoryTypeBits = any_type },
+                  vk::MemoryPropertyFlagBits::eDeviceLocal));
+            }
+            else {
+                allocator.free(live[o.slot]);
+                live[o.slot] = live.back();
+                live.pop_back();
+            }
+        }
+    }
+
+    template<typename A>
+    void measure(std::string_view name, const std::vector<op>& ops) {
+        auto best { std::chrono::nanoseconds::max() };
+
+        for ( int r = 0; r < repetitions; ++r ) {
+            A                                    allocator {};
+            std::vector<typename A::suballoc_t*> live {};
+
+            const auto start { clock_type::now() };
+            replay(allocator, live, ops);
+            const auto elapsed { clock_type::now() - start };
+
+            best = std::min(
+              best,
+              std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+
+            for ( auto s : live ) {
+                allocator.free(s);
+            }
+            A::_free_pool();
+        }
+
+        std::cout << std::left << std::setw(24) << name << std::right
+                  << std::setw(10) << ops.size() << std::setw(12) << std::fixed
+                  << std::setprecision(2)
+                  << double(best.count()) / double(ops.size()) << '\n';
+    }
+
+    // how much of its pools the buddy allocator loses, after one run that
+    // keeps its live allocations
+    void buddy_fragmentation(std::string_view       name,
+                             const std::vector<op>& ops) {
+        vma::buddy_allocator                         allocator {};
+        std::vector<vma::buddy_allocator::suballoc*> live {};
+
+        replay(allocator, live, ops);
+
+        const auto stats { vma::buddy_allocator::stats() };
+        std::cout << std::left << std::setw(24) << name << std::right
+                  << std::setw(10) << stats.allocations << std::setw(12)
+                  << std::fixed << std::setprecision(3)
+                  << stats.internal_fragmentation() << std::setw(12)
+                  << stats.external_fragmentation() << '\n';
+
+        for ( auto s : live ) {
+            allocator.free(s);
+        }
+        vma::buddy_allocator::_free_pool();
+    }
+
+    // a device with one queue of the first physical device, nothing else
+    // is needed to allocate memory
+    vk::UniqueDevice create_device(vk::PhysicalDevice physical) {
+        const float priority { 1.f };
+
+        const vk::DeviceQueueCreateInfo queue {
+            .queueFamilyIndex = 0,
+            .queueCount       = 1,
+            .pQueuePriorities = &priority,
+        };
+
+        auto device { physical.createDeviceUnique({
+          .queueCreateInfoCount = 1,
+          .pQueueCreateInfos    = &queue,
+        }) };
+
+        VULKAN_HPP_DEFAULT_DISPATCHER.init(*device);
+        return device;
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+
+    size_t op_count { 200'000 };
+    size_t live { 1'000 };
+
+    for ( int i = 1; i < argc; ++i ) {
+        const std::string_view arg { argv[i] };
+
+        if ( arg == "--ops" && i + 1 < argc ) {
+            op_count = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if ( arg == "--live" && i + 1 < argc
+                  && std::strtoull(argv[i + 1], nullptr, 10) > 0 )
+        {
+            live = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--ops <n>] [--live <n>]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    try {
+        potato::graphics::instance instance {};
+
+        const auto physicals { instance.get().enumeratePhysicalDevices() };
+        if ( physicals.empty() ) {
+            throw std::runtime_error("No Vulkan device found");
+        }
+
+        const auto physical { physicals.front() };
+        const auto device { create_device(physical) };
+        vma::init(physical, *device);
+
+        std::cout << std::left << std::setw(24) << "benchmark" << std::right
+                  << std::setw(10) << "ops" << std::setw(12) << "ns/op"
+                  << '\n';
+
+        for ( const bool pow2 : { true, false } ) {
+            const std::string sizes { pow2 ? ".pow2" : ".odd" };
+
+            const auto ops { make_ops(op_count, live, pow2) };
+            const auto few { make_ops(op_count / 10, live, pow2) };
+
+            measure<vma::buddy_allocator>("buddy" + sizes, ops);
+            measure<vma::tlsf_allocator>("tlsf" + sizes, ops);
+            measure<vma::linear_allocator>("linear" + sizes, few);
+        }
+
+        std::cout << '\n'
+                  << std::left << std::setw(24) << "fragmentation"
+                  << std::right << std::setw(10) << "live" << std::setw(12)
+                  << "internal" << std::setw(12) << "external" << '\n';
+
+        buddy_fragmentation("buddy.pow2", make_ops(op_count, live, true));
+        buddy_fragmentation("buddy.odd", make_ops(op_count, live, false));
+
+        vma::deinit();
+    }
+    catch ( const std::exception& e ) {
+        std::cerr << "Exception: " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,531 @@
+#include <ecs/component.hpp>
+#include <ecs/context.hpp>
+#include <ecs/culling.hpp>
+#include <ecs/entity.hpp>
+#include <ecs/group.hpp>
+#include <ecs/observer.hpp>
+#include <ecs/spatial.hpp>
+#include <ecs/tag.hpp>
+#include <ecs/transform.hpp>
+#include <ecs/view.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Micro-benchmarks of the ECS storage. Every case runs a few times on fresh
+// data and keeps the fastest run, reported as nanoseconds per operation.
+//
+//   potato_ecs_bench [--max <entities>] [--json <file>]
+//
+// --max caps the entity counts, which go from 1k up to 1M. --json also
+// writes the results to <file>, for regression tracking. A few checks of
+// the results run first, the bench fails rather than time a broken build.
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    // component of exactly Bytes bytes
+    template<size_t Bytes>
+    struct payload {
+        std::array<uint8_t, Bytes> bytes {};
+    };
+
+    struct velocity {
+        float x {}, y {}, z {}, w {};
+    };
+
+    // tag, nothing is stored per entity
+    struct flagged {};
+
+    struct result {
+        std::string name {};
+        size_t      entities {};
+        size_t      component_bytes {};
+        double      ns_per_op {};
+    };
+
+    constexpr int repetitions = 5;
+
+    std::vector<result> results {};
+
+    // Runs setup() then the timed body(), `repetitions` times, and records
+    // the fastest body as ns per op, with `ops` operations per run
+    template<typename Setup, typename Body>
+    void measure(std::string_view name,
+                 size_t           entities,
+                 size_t           component_bytes,
+                 size_t           ops,
+                 Setup&&          setup,
+                 Body&&           body) {
+        auto best { std::chrono::nanoseconds::max() };
+
+        for ( int r = 0; r < repetitions; ++r ) {
+            setup();
+
+            const auto start { clock_type::now() };
+            body();
+            const auto elapsed { clock_type::now() - start };
+
+            best = std::min(
+              best,
+              std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+        }
+
+        const result res { std::string { name },
+                           entities,
+                           component_bytes,
+                           double(best.count()) / double(ops) };
+
+        std::cout << std::left << std::setw(24) << res.name << std::right
+                  << std::setw(10) << res.entities << std::setw(8)
+                  << res.component_bytes << std::setw(12) << std::fixed
+                  << std::setprecision(2) << res.ns_per_op << '\n';
+
+        results.push_back(res);
+    }
+
+    // keeps the optimizer from dropping reads whose result is unused
+    volatile uint64_t sink {};
+
+    std::vector<ecs::entity_id> shuffled_ids(size_t n) {
+        std::vector<ecs::entity_id> ids(n);
+        for ( uint32_t i = 0; i < n; ++i ) {
+            ids[i] = { i, 1 };
+        }
+
+        std::shuffle(ids.begin(), ids.end(), std::mt19937 { 42 });
+        return ids;
+    }
+
+    void check(bool ok, std::string_view what) {
+        if ( !ok ) {
+            throw std::runtime_error("Check failed: " + std::string { what });
+        }
+    }
+
+    template<typename E, typename F>
+    bool throws(F&& fn) {
+        try {
+            fn();
+        }
+        catch ( const E& ) {
+            return true;
+        }
+        return false;
+    }
+
+    // context::add and get fail the same way in both storage modes
+    void check_errors(ecs::storage mode) {
+        ecs::context ctx { mode };
+        ctx.add_component<velocity>();
+        ctx.add_component<payload<4>>();
+
+        const auto eid { ctx.create() };
+        const auto bare { ctx.create() };
+        ctx.add<velocity>(eid, 1.f, 2.f, 3.f, 0.f);
+
+        check(throws<std::logic_error>(
+                [&] { ctx.add<velocity>(eid, 4.f, 5.f, 6.f, 0.f); }),
+              "adding a component twice throws");
+        check(ctx.get<velocity>(eid).x == 1.f,
+              "a rejected add leaves the component alone");
+        check(throws<std::out_of_range>([&] { ctx.get<payload<4>>(eid); }),
+              "getting a missing component throws");
+        check(throws<std::out_of_range>([&] { ctx.get<velocity>(bare); }),
+              "getting from an entity without components throws");
+    }
+
+    // a parallel pass over a view visits every match once and only those
+    void check_par_each() {
+        constexpr size_t n { 100'000 };
+
+        ecs::context ctx {};
+        ctx.add_component<velocity>();
+        ctx.add_component<flagged>();
+
+        const auto ids { ctx.create_entities(n) };
+        for ( size_t i = 0; i < n; ++i ) {
+            ctx.add<velocity>(ids[i], float(i), 0.f, 0.f, 0.f);
+            if ( i % 3 != 0 ) ctx.add<flagged>(ids[i]);
+        }
+
+        potato::jobs::pool workers { 4 };
+        ctx.view<velocity, const flagged>().par_each(
+          [](ecs::entity_id, velocity& v, const flagged&) {
+              v.y += v.x + 1.f;
+          },
+          64,
+          workers);
+
+        for ( size_t i = 0; i < n; ++i ) {
+            const auto& v { ctx.get<velocity>(ids[i]) };
+            check(v.y == (i % 3 != 0 ? float(i) + 1.f : 0.f),
+                  "par_each visits every matching entity once");
+        }
+    }
+
+    void run_checks() {
+        check_errors(ecs::storage::sparse);
+        check_errors(ecs::storage::archetype);
+        check_par_each();
+    }
+
+    template<size_t Bytes>
+    void bench_store(size_t n) {
+        using T = payload<Bytes>;
+
+        const auto ids { shuffled_ids(n) };
+        std::unique_ptr<ecs::components<T>> store {};
+
+        auto fresh = [&] {
+            store = std::make_unique<ecs::components<T>>();
+        };
+
+        auto filled = [&] {
+            fresh();
+            for ( auto eid : ids ) {
+                store->add(eid);
+            }
+        };
+
+        measure("components.add", n, Bytes, n, fresh, [&] {
+            for ( auto eid : ids ) {
+                store->add(eid);
+            }
+        });
+
+        filled();
+        measure(
+          "components.get", n, Bytes, n, [] {}, [&] {
+              uint64_t sum {};
+              for ( auto eid : ids ) {
+                  sum += store->get(eid).bytes[0];
+              }
+              sink = sum;
+          });
+
+        // every get() is recorded, the store has no clock to dedupe with
+        {
+            ecs::observer<T> watch { *store };
+
+            auto drained = [&] {
+                watch.drain([](const ecs::event&) {});
+            };
+
+            measure("components.get_observed", n, Bytes, n, drained, [&] {
+                uint64_t sum {};
+                for ( auto eid : ids ) {
+                    sum += store->get(eid).bytes[0];
+                }
+                sink = sum;
+            });
+        }
+
+        measure("components.remove", n, Bytes, n, filled, [&] {
+            for ( auto eid : ids ) {
+                store->remove(eid);
+            }
+        });
+    }
+
+    void bench_entities(size_t n) {
+        std::unique_ptr<ecs::context> ctx {};
+        std::vector<ecs::entity>      entities {};
+
+        auto fresh = [&] {
+            entities.clear();
+            ctx = std::make_unique<ecs::context>();
+            ctx->add_component<velocity>();
+            entities.reserve(n);
+        };
+
+        auto filled = [&] {
+            fresh();
+            for ( size_t i = 0; i < n; ++i ) {
+                entities.push_back(ctx->create_entity());
+            }
+        };
+
+        measure("context.create_entity", n, 0, n, fresh, [&] {
+            for ( size_t i = 0; i < n; ++i ) {
+                entities.push_back(ctx->create_entity());
+            }
+        });
+
+        // entities remove themselves from the context as they go away
+        measure("context.remove_entity", n, 0, n, filled, [&] {
+            entities.clear();
+        });
+
+        entities.clear();
+    }
+
+    // every entity has a payload, half of them a velocity too and the
+    // other half the flagged tag
+    template<size_t Bytes>
+    void bench_view(size_t n) {
+        using T = payload<Bytes>;
+
+        ecs::context ctx {};
+        ctx.add_component<T>();
+        ctx.add_component<velocity>();
+        ctx.add_component<flagged>();
+
+        const auto ids { ctx.create_entities(n) };
+        for ( size_t i = 0; i < n; ++i ) {
+            ctx.add<T>(ids[i]);
+            if ( i % 2 == 0 ) ctx.add<velocity>(ids[i], 1.f, 2.f, 3.f, 0.f);
+            else ctx.add<flagged>(ids[i]);
+        }
+
+        measure(
+          "view.iterate", n, Bytes, n, [] {}, [&] {
+              for ( auto [eid, p, v] : ctx.view<T, const velocity>() ) {
+                  p.bytes[0] += static_cast<uint8_t>(v.x);
+              }
+          });
+
+        measure(
+          "view.par_each", n, Bytes, n, [] {}, [&] {
+              ctx.view<T, const velocity>().par_each(
+                [](ecs::entity_id, T& p, const velocity& v) {
+                    p.bytes[0] += static_cast<uint8_t>(v.x);
+                });
+          });
+
+        measure(
+          "view.tagged", n, Bytes, n, [] {}, [&] {
+              for ( auto [eid, p, f] : ctx.view<T, const flagged>() ) {
+                  ++p.bytes[0];
+              }
+          });
+
+        // same data, packed by a group
+        auto& packed { ctx.group<T, velocity>() };
+        measure(
+          "group.iterate", n, Bytes, n, [] {}, [&] {
+              packed.each([](ecs::entity_id, T& p, velocity& v) {
+                  p.bytes[0] += static_cast<uint8_t>(v.x);
+              });
+          });
+    }
+
+    // roots with 15 children each, every transform changed every frame
+    void bench_transforms(size_t n) {
+        ecs::context ctx {};
+        ctx.add_component<transform>();
+        ctx.add_component<world_transform>();
+        ctx.add_component<hierarchy>();
+
+        const auto ids { ctx.create_entities(n) };
+        for ( size_t i = 0; i < n; ++i ) {
+            ctx.add<transform>(ids[i]).translation = { float(i), 0.f, 0.f };
+            ctx.add<world_transform>(ids[i]);
+            if ( i % 16 != 0 ) ctx.add<hierarchy>(ids[i], ids[i - i % 16]);
+        }
+
+        ecs::transform_system system {};
+        system.run(ctx);
+
+        auto& transforms { ctx.get_component<transform>() };
+
+        auto touch_all = [&] {
+            ctx.advance_tick();
+            for ( auto eid : transforms.ids() ) {
+                transforms.touch(eid);
+            }
+        };
+
+        measure("transform.update", n, sizeof(transform), n, touch_all, [&] {
+            system.run(ctx);
+        });
+    }
+
+    // entities spread over a cube, a tenth of them moving every frame
+    void bench_spatial(size_t n, ecs::spatial_layout layout) {
+        ecs::context ctx {};
+        ctx.add_component<transform>();
+        ctx.add_component<world_transform>();
+        ctx.add_component<bounds>();
+
+        std::mt19937                          rng { 42 };
+        std::uniform_real_distribution<float> coord { -500.f, 500.f };
+
+        const auto ids { ctx.create_entities(n) };
+        for ( auto eid : ids ) {
+            ctx.add<transform>(eid).translation = { coord(rng),
+                                                    coord(rng),
+                                                    coord(rng) };
+            ctx.add<world_transform>(eid);
+            ctx.add<bounds>(eid);
+        }
+
+        ecs::transform_system system {};
+        ecs::spatial_index    index { { .layout = layout } };
+        system.run(ctx);
+        index.update(ctx);
+
+        const std::string prefix { layout == ecs::spatial_layout::bvh
+                                     ? "bvh."
+                                     : "grid." };
+
+        auto move_some = [&] {
+            ctx.advance_tick();
+            for ( size_t i = 0; i < n; i += 10 ) {
+                ctx.get<transform>(ids[i]).translation.x += .5f;
+            }
+            system.run(ctx);
+        };
+
+        measure(prefix + "update", n, sizeof(bounds), n / 10, move_some, [&] {
+            index.update(ctx);
+        });
+
+        constexpr size_t            queries = 1000;
+        std::vector<ecs::entity_id> found {};
+
+        measure(
+          prefix + "query", n, sizeof(bounds), queries, [] {}, [&] {
+              for ( size_t q = 0; q < queries; ++q ) {
+                  const glm::vec3 corner { coord(rng), coord(rng), coord(rng) };
+                  const potato::math::aabb box { corner,
+                                                 corner + glm::vec3 { 50.f } };
+                  found.clear();
+                  index.query(box, found);
+              }
+              sink = found.size();
+          });
+    }
+
+    // entities spread over a cube, a camera at its center looking down +z
+    // with a 90 degree field of view sees about a sixth of them
+    void bench_culling(size_t n) {
+        ecs::context ctx {};
+        ctx.add_component<transform>();
+        ctx.add_component<world_transform>();
+        ctx.add_component<bounds>();
+
+        std::mt19937                          rng { 42 };
+        std::uniform_real_distribution<float> coord { -500.f, 500.f };
+
+        for ( auto eid : ctx.create_entities(n) ) {
+            ctx.add<transform>(eid).translation = { coord(rng),
+                                                    coord(rng),
+                                                    coord(rng) };
+            ctx.add<world_transform>(eid);
+            ctx.add<bounds>(eid);
+        }
+
+        ecs::transform_system{}.run(ctx);
+
+        // the projection of testapp::camera, with an identity view
+        constexpr float z_near { .1f }, z_far { 1000.f };
+
+        glm::mat4 projection { 0.f };
+        projection[0][0] = 1.f;
+        projection[1][1] = 1.f;
+        projection[2][2] = z_far / (z_far - z_near);
+        projection[2][3] = 1.f;
+        projection[3][2] = -(z_far * z_near) / (z_far - z_near);
+
+        const auto view { potato::math::frustum::from_matrix(projection) };
+
+        ecs::culling_system culling {};
+        measure(
+          "culling.run", n, sizeof(bounds), n, [] {}, [&] {
+              culling.run(ctx, view);
+              sink = culling.visible().size();
+          });
+    }
+
+    void write_json(const std::string& fname) {
+        std::ofstream out { fname };
+        if ( !out.is_open() ) {
+            throw std::runtime_error("Could not open file for writing");
+        }
+
+        out << "{\n  \"benchmarks\": [\n";
+        for ( size_t i = 0; i < results.size(); ++i ) {
+            const auto& r { results[i] };
+            out << "    { \"name\": \"" << r.name << "\", \"entities\": "
+                << r.entities << ", \"component_bytes\": " << r.component_bytes
+                << ", \"ns_per_op\": " << std::fixed << std::setprecision(3)
+                << r.ns_per_op << " }" << (i + 1 < results.size() ? "," : "")
+                << '\n';
+        }
+        out << "  ]\n}\n";
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+
+    size_t      max_entities { 1'000'000 };
+    std::string json {};
+
+    for ( int i = 1; i < argc; ++i ) {
+        const std::string_view arg { argv[i] };
+
+        if ( arg == "--max" && i + 1 < argc ) {
+            max_entities = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if ( arg == "--json" && i + 1 < argc ) {
+            json = argv[++i];
+        }
+        else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--max <entities>] [--json <file>]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    try {
+        run_checks();
+
+        std::cout << std::left << std::setw(24) << "benchmark" << std::right
+                  << std::setw(10) << "entities" << std::setw(8) << "bytes"
+                  << std::setw(12) << "ns/op" << '\n';
+
+        for ( size_t n = 1'000; n <= max_entities; n *= 10 ) {
+            bench_store<4>(n);
+            bench_store<16>(n);
+            bench_store<64>(n);
+            bench_store<256>(n);
+
+            bench_entities(n);
+
+            bench_view<4>(n);
+            bench_view<64>(n);
+            bench_view<256>(n);
+
+            bench_transforms(n);
+
+            bench_culling(n);
+
+            bench_spatial(n, ecs::spatial_layout::bvh);
+            bench_spatial(n, ecs::spatial_layout::grid);
+        }
+
+        if ( !json.empty() ) write_json(json);
+    }
+    catch ( const std::exception& e ) {
+        std::cerr << "Exception: " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
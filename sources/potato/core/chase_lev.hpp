@@ -0,0 +1,147 @@
+#ifndef POTATO_CORE_CHASE_LEV_HPP
+#define POTATO_CORE_CHASE_LEV_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace potato::jobs {
+
+    // Chase-Lev work-stealing deque, following "Correct and Efficient
+    // Work-Stealing for Weak Memory Models" (Le et al., 2013).
+    //
+    // The owning thread pushes and takes at the bottom, any other thread
+    // steals from the top. Holds raw pointers, nullptr means "nothing".
+    // Arrays that are outgrown are kept until the deque dies, since a thief
+    // may still be reading from them.
+    template<typename T>
+    class chase_lev_deque {
+      private:
+        struct ring {
+            int64_t                            capacity {};
+            std::unique_ptr<std::atomic<T*>[]> items {};
+
+            explicit ring(int64_t cap)
+              : capacity { cap }
+              , items { std::make_unique<std::atomic<T*>[]>(cap) } {}
+
+            T* get(int64_t i) const {
+                return items[i & (capacity - 1)].load(
+                  std::memory_order_relaxed);
+            }
+
+            void put(int64_t i, T* item) {
+                items[i & (capacity - 1)].store(item,
+                                                std::memory_order_relaxed);
+            }
+        };
+
+        alignas(64) std::atomic<int64_t> top { 0 };
+        alignas(64) std::atomic<int64_t> bottom { 0 };
+        alignas(64) std::atomic<ring*> array {};
+
+        // owner-only, every ring ever used
+        std::vector<std::unique_ptr<ring>> rings {};
+
+        ring* grow(ring* old, int64_t b, int64_t t) {
+            auto bigger { std::make_unique<ring>(old->capacity * 2) };
+
+            for ( auto i = t; i < b; ++i ) {
+                bigger->put(i, old->get(i));
+            }
+
+            rings.push_back(std::move(bigger));
+            return rings.back().get();
+        }
+
+      public:
+        // capacity must be a power of two
+        explicit chase_lev_deque(int64_t capacity = 1024) {
+            rings.push_back(std::make_unique<ring>(capacity));
+            array.store(rings.back().get(), std::memory_order_relaxed);
+        }
+
+        // no copy, no move, other threads hold on to it
+        chase_lev_deque(const chase_lev_deque&) = delete;
+        chase_lev_deque& operator=(const chase_lev_deque&) = delete;
+
+        // Owner only
+        void push(T* item) {
+            auto b { bottom.load(std::memory_order_relaxed) };
+            auto t { top.load(std::memory_order_acquire) };
+            auto a { array.load(std::memory_order_relaxed) };
+
+            if ( b - t > a->capacity - 1 ) {
+                a = grow(a, b, t);
+                array.store(a, std::memory_order_release);
+            }
+
+            a->put(b, item);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        // Owner only, LIFO end
+        T* take() {
+            auto b { bottom.load(std::memory_order_relaxed) - 1 };
+            auto a { array.load(std::memory_order_relaxed) };
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto t { top.load(std::memory_order_relaxed) };
+
+            if ( t > b ) {
+                // empty
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            T* item { a->get(b) };
+
+            if ( t == b ) {
+                // last item, race the thieves for it
+                if ( !top.compare_exchange_strong(t,
+                                                  t + 1,
+                                                  std::memory_order_seq_cst,
+                                                  std::memory_order_relaxed) )
+                {
+                    item = nullptr;
+                }
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+
+            return item;
+        }
+
+        // Any thread, FIFO end. Returns nullptr if empty or if another thread
+        // won the race for the item
+        T* steal() {
+            auto t { top.load(std::memory_order_acquire) };
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto b { bottom.load(std::memory_order_acquire) };
+
+            if ( t >= b ) return nullptr;
+
+            auto a { array.load(std::memory_order_acquire) };
+            T*   item { a->get(t) };
+
+            if ( !top.compare_exchange_strong(t,
+                                              t + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed) )
+            {
+                return nullptr;
+            }
+
+            return item;
+        }
+
+        bool empty() const {
+            return bottom.load(std::memory_order_relaxed)
+                <= top.load(std::memory_order_relaxed);
+        }
+    };
+
+}  // namespace potato::jobs
+
+#endif
@@ -0,0 +1,152 @@
+#include "culling.hpp"
+
+#include "simd.hpp"
+#include "trs.hpp"
+
+#include <cassert>
+
+namespace {
+    using potato::math::frustum;
+    using potato::math::simd_level;
+    using potato::math::sphere_view;
+
+    void cull_scalar(const frustum&     f,
+                     const sphere_view& in,
+                     uint32_t*          visible,
+                     size_t&            count,
+                     size_t             first) {
+        for ( auto i { first }; i < in.size(); ++i ) {
+            const glm::vec3 center { in.x[i], in.y[i], in.z[i] };
+
+            bool inside { true };
+            for ( const auto& p : f.planes ) {
+                inside = inside && p.distance(center) >= -in.radius[i];
+            }
+
+            // written either way, only kept if inside
+            visible[count] = static_cast<uint32_t>(i);
+            count += inside;
+        }
+    }
+
+#ifdef POTATO_X86
+    // The SIMD kernels hold one sphere per lane and go through the planes
+    // one at a time. Indices of the lanes that pass are appended without
+    // branching, by always writing and only advancing past the kept ones.
+
+    POTATO_TARGET("sse4.1")
+    size_t cull_sse4(const frustum&     f,
+                     const sphere_view& in,
+                     uint32_t*          visible,
+                     size_t&            count) {
+        const size_t n { in.size() & ~size_t(3) };
+
+        for ( size_t i = 0; i < n; i += 4 ) {
+            const __m128 x { _mm_loadu_ps(&in.x[i]) };
+            const __m128 y { _mm_loadu_ps(&in.y[i]) };
+            const __m128 z { _mm_loadu_ps(&in.z[i]) };
+            const __m128 reach { _mm_sub_ps(_mm_setzero_ps(),
+                                            _mm_loadu_ps(&in.radius[i])) };
+
+            __m128 inside { _mm_castsi128_ps(_mm_set1_epi32(-1)) };
+            for ( const auto& p : f.planes ) {
+                const __m128 d { _mm_add_ps(
+                  _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(p.normal.x)),
+                             _mm_mul_ps(y, _mm_set1_ps(p.normal.y))),
+                  _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(p.normal.z)),
+                             _mm_set1_ps(p.d))) };
+
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(d, reach));
+            }
+
+            const int mask { _mm_movemask_ps(inside) };
+            if ( mask == 0 ) continue;
+
+            for ( int lane = 0; lane < 4; ++lane ) {
+                visible[count] = static_cast<uint32_t>(i + lane);
+                count += (mask >> lane) & 1;
+            }
+        }
+
+        return n;
+    }
+
+    POTATO_TARGET("avx2")
+    size_t cull_avx2(const frustum&     f,
+                     const sphere_view& in,
+                     uint32_t*          visible,
+                     size_t&            count) {
+        const size_t n { in.size() & ~size_t(7) };
+
+        for ( size_t i = 0; i < n; i += 8 ) {
+            const __m256 x { _mm256_loadu_ps(&in.x[i]) };
+            const __m256 y { _mm256_loadu_ps(&in.y[i]) };
+            const __m256 z { _mm256_loadu_ps(&in.z[i]) };
+            const __m256 reach { _mm256_sub_ps(
+              _mm256_setzero_ps(), _mm256_loadu_ps(&in.radius[i])) };
+
+            __m256 inside { _mm256_castsi256_ps(_mm256_set1_epi32(-1)) };
+            for ( const auto& p : f.planes ) {
+                const __m256 d { _mm256_add_ps(
+                  _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(p.normal.x)),
+                                _mm256_mul_ps(y, _mm256_set1_ps(p.normal.y))),
+                  _mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(p.normal.z)),
+                                _mm256_set1_ps(p.d))) };
+
+                inside = _mm256_and_ps(inside,
+                                       _mm256_cmp_ps(d, reach, _CMP_GE_OQ));
+            }
+
+            const int mask { _mm256_movemask_ps(inside) };
+            if ( mask == 0 ) continue;
+
+            for ( int lane = 0; lane < 8; ++lane ) {
+                visible[count] = static_cast<uint32_t>(i + lane);
+                count += (mask >> lane) & 1;
+            }
+        }
+
+        return n;
+    }
+#endif
+}  // namespace
+
+namespace potato::math {
+
+    void sphere_buffer::resize(size_t n) {
+        for ( auto v : { &x, &y, &z, &radius } ) {
+            v->resize(n);
+        }
+    }
+
+    sphere_view sphere_buffer::view() const {
+        return { x, y, z, radius };
+    }
+
+    size_t cull_spheres(const frustum&      f,
+                        const sphere_view&  in,
+                        std::span<uint32_t> visible) {
+        assert(visible.size() >= in.size());
+
+        size_t count {};
+        size_t done {};
+
+#ifdef POTATO_X86
+        switch ( active_simd_level() ) {
+            case simd_level::avx2:
+                done = cull_avx2(f, in, visible.data(), count);
+                break;
+            case simd_level::sse4:
+                done = cull_sse4(f, in, visible.data(), count);
+                break;
+            case simd_level::scalar:
+                break;
+        }
+#endif
+
+        // whatever did not fill a whole register
+        cull_scalar(f, in, visible.data(), count, done);
+        return count;
+    }
+
+}  // namespace potato::math
@@ -0,0 +1,66 @@
+#ifndef POTATO_CORE_CULLING_HPP
+#define POTATO_CORE_CULLING_HPP
+
+#include "geometry.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace potato::math {
+
+    // Non-owning structure-of-arrays view of bounding spheres. Element i of
+    // each span belongs to sphere i
+    struct sphere_view {
+        std::span<const float> x, y, z;
+        std::span<const float> radius;
+
+        size_t size() const {
+            return x.size();
+        }
+
+        // spheres [offset, offset + count)
+        sphere_view subview(size_t offset, size_t count) const {
+            return { x.subspan(offset, count),
+                     y.subspan(offset, count),
+                     z.subspan(offset, count),
+                     radius.subspan(offset, count) };
+        }
+    };
+
+    // Owning structure-of-arrays storage for sphere_view, meant to be kept
+    // around and refilled every frame
+    class sphere_buffer {
+      private:
+        std::vector<float> x, y, z;
+        std::vector<float> radius;
+
+      public:
+        void resize(size_t n);
+
+        void set(size_t i, const sphere& s) {
+            x[i]      = s.center.x;
+            y[i]      = s.center.y;
+            z[i]      = s.center.z;
+            radius[i] = s.radius;
+        }
+
+        size_t size() const {
+            return x.size();
+        }
+
+        sphere_view view() const;
+    };
+
+    // Writes the index of every sphere of `in` that overlaps f to `visible`,
+    // in increasing order, and returns how many it wrote. `visible` must be
+    // at least in.size() long. Tests 4 or 8 spheres at once against all six
+    // planes, depending on active_simd_level()
+    size_t cull_spheres(const frustum&      f,
+                        const sphere_view&  in,
+                        std::span<uint32_t> visible);
+
+}  // namespace potato::math
+
+#endif
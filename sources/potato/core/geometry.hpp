@@ -0,0 +1,192 @@
+#ifndef POTATO_CORE_GEOMETRY_HPP
+#define POTATO_CORE_GEOMETRY_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <optional>
+#include <utility>
+
+namespace potato::math {
+
+    struct sphere {
+        glm::vec3 center {};
+        float     radius {};
+
+        // Holds this one once transformed by m, scaled by the longest axis
+        // of m when m does not scale uniformly
+        sphere transformed(const glm::mat4& m) const {
+            const glm::vec3 x { m[0] }, y { m[1] }, z { m[2] };
+            const auto longest { std::max(
+              { glm::dot(x, x), glm::dot(y, y), glm::dot(z, z) }) };
+
+            return { glm::vec3 { m * glm::vec4 { center, 1.f } },
+                     radius * std::sqrt(longest) };
+        }
+
+        // Same, for the transform made of translation t, rotation r and
+        // scale s, without building its matrix
+        sphere transformed(const glm::vec3& t,
+                           const glm::quat& r,
+                           const glm::vec3& s) const {
+            const auto longest { std::max(
+              { std::abs(s.x), std::abs(s.y), std::abs(s.z) }) };
+
+            return { t + r * (s * center), radius * longest };
+        }
+    };
+
+    // Axis aligned box, min <= max on every axis
+    struct aabb {
+        glm::vec3 min {};
+        glm::vec3 max {};
+
+        glm::vec3 center() const {
+            return (min + max) * .5f;
+        }
+
+        // half of the size on each axis
+        glm::vec3 extents() const {
+            return (max - min) * .5f;
+        }
+
+        float surface_area() const {
+            const auto d { max - min };
+            return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+        }
+
+        bool contains(const aabb& other) const {
+            return min.x <= other.min.x && min.y <= other.min.y
+                && min.z <= other.min.z && other.max.x <= max.x
+                && other.max.y <= max.y && other.max.z <= max.z;
+        }
+
+        aabb expanded(float margin) const {
+            return { min - glm::vec3 { margin }, max + glm::vec3 { margin } };
+        }
+
+        // Smallest box holding this one once transformed by m
+        aabb transformed(const glm::mat4& m) const {
+            const auto c { center() };
+            const auto e { extents() };
+
+            const glm::vec3 origin { m * glm::vec4 { c, 1.f } };
+            const glm::vec3 reach { glm::abs(glm::vec3 { m[0] }) * e.x
+                                    + glm::abs(glm::vec3 { m[1] }) * e.y
+                                    + glm::abs(glm::vec3 { m[2] }) * e.z };
+            return { origin - reach, origin + reach };
+        }
+
+        sphere bounding_sphere() const {
+            return { center(), glm::length(extents()) };
+        }
+
+        static aabb merge(const aabb& a, const aabb& b) {
+            return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+        }
+    };
+
+    // Half line starting at origin, direction need not be normalized but
+    // distances are then in multiples of its length
+    struct ray {
+        glm::vec3 origin {};
+        glm::vec3 direction { 0.f, 0.f, 1.f };
+    };
+
+    // Points p with dot(normal, p) + d >= 0 are in front of the plane
+    struct plane {
+        glm::vec3 normal {};
+        float     d {};
+
+        float distance(const glm::vec3& p) const {
+            return glm::dot(normal, p) + d;
+        }
+    };
+
+    // Volume enclosed by six planes facing inwards
+    struct frustum {
+        std::array<plane, 6> planes {};
+
+        // The frustum a projection * view matrix clips to, in world space.
+        // Takes the depth range of Vulkan, 0 <= z <= w, and gives the
+        // planes in the order x >= -w, x <= w, y >= -w, y <= w, then near
+        // and far. The normals are unit length, so plane::distance is the
+        // distance in world units
+        static frustum from_matrix(const glm::mat4& m) {
+            // row i of m is m[0][i] m[1][i] m[2][i] m[3][i]
+            auto row = [&](int i) {
+                return glm::vec4 { m[0][i], m[1][i], m[2][i], m[3][i] };
+            };
+
+            const auto x { row(0) }, y { row(1) }, z { row(2) }, w { row(3) };
+            const std::array<glm::vec4, 6> rows {
+                w + x, w - x, w + y, w - y, z, w - z,
+            };
+
+            frustum f {};
+            for ( size_t i = 0; i < rows.size(); ++i ) {
+                const glm::vec3 normal { rows[i] };
+                const auto      length { glm::length(normal) };
+
+                f.planes[i] = { normal / length, rows[i].w / length };
+            }
+            return f;
+        }
+    };
+
+    inline bool overlaps(const aabb& a, const aabb& b) {
+        return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y
+            && b.min.y <= a.max.y && a.min.z <= b.max.z && b.min.z <= a.max.z;
+    }
+
+    inline bool overlaps(const sphere& s, const aabb& box) {
+        const auto closest { glm::clamp(s.center, box.min, box.max) };
+        const auto d { s.center - closest };
+        return glm::dot(d, d) <= s.radius * s.radius;
+    }
+
+    // Conservative, boxes near a corner of the frustum but outside of it
+    // can pass
+    inline bool overlaps(const frustum& f, const aabb& box) {
+        const auto c { box.center() };
+        const auto e { box.extents() };
+
+        return std::ranges::all_of(f.planes, [&](const plane& p) {
+            return p.distance(c) + glm::dot(glm::abs(p.normal), e) >= 0.f;
+        });
+    }
+
+    inline bool overlaps(const frustum& f, const sphere& s) {
+        return std::ranges::all_of(f.planes, [&](const plane& p) {
+            return p.distance(s.center) >= -s.radius;
+        });
+    }
+
+    // Distance along r at which it enters box, 0 if it starts inside.
+    // Nothing if it misses the box or only reaches it past max_distance
+    inline std::optional<float> intersect(const ray&  r,
+                                          const aabb& box,
+                                          float       max_distance) {
+        float enter { 0.f };
+        float leave { max_distance };
+
+        for ( int axis = 0; axis < 3; ++axis ) {
+            const auto inv { 1.f / r.direction[axis] };
+
+            auto t0 { (box.min[axis] - r.origin[axis]) * inv };
+            auto t1 { (box.max[axis] - r.origin[axis]) * inv };
+            if ( inv < 0.f ) std::swap(t0, t1);
+
+            // a NaN, from a zero direction with the origin on a face of
+            // the box, leaves both as they are
+            enter = t0 > enter ? t0 : enter;
+            leave = t1 < leave ? t1 : leave;
+            if ( leave < enter ) return std::nullopt;
+        }
+
+        return enter;
+    }
+
+}  // namespace potato::math
+
+#endif
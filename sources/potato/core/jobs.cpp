@@ -0,0 +1,222 @@
+#include "jobs.hpp"
+
+#include "thread.hpp"
+
+#include <stdexcept>
+
+namespace {
+    // which pool, if any, the current thread works for
+    thread_local const potato::jobs::pool* current_pool { nullptr };
+    thread_local int                        current_index { -1 };
+}  // namespace
+
+namespace potato::jobs {
+
+    // class pool
+    pool::pool(unsigned threads, std::string name) {
+        if ( threads == 0 ) {
+            threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        }
+
+        // every deque must exist before any worker starts stealing
+        workers.reserve(threads);
+        for ( unsigned i = 0; i < threads; ++i ) {
+            workers.push_back(std::make_unique<worker>());
+        }
+
+        for ( unsigned i = 0; i < threads; ++i ) {
+            workers[i]->thread = std::jthread { [this, i, name] {
+                worker_loop(i, name);
+            } };
+        }
+    }
+
+    pool::~pool() {
+        {
+            std::scoped_lock lock { sleep_mut };
+            stopping = true;
+        }
+        sleep_cv.notify_all();
+
+        for ( auto& w : workers ) {
+            w->thread.join();
+        }
+
+        // the threads are gone, drop whatever nobody got to. Their groups
+        // are told, or they would wait for the tasks forever
+        for ( auto& w : workers ) {
+            while ( auto t { w->tasks.take() } ) {
+                drop(t);
+            }
+        }
+        for ( auto t : injected ) {
+            drop(t);
+        }
+    }
+
+    void pool::drop(task* t) {
+        auto group { t->group };
+        delete t;
+
+        if ( group ) {
+            group->finish(std::make_exception_ptr(
+              std::runtime_error("Job pool stopped before the task ran")));
+        }
+    }
+
+    void pool::push(task t) {
+        auto item { new task(std::move(t)) };
+
+        // counted before it is published, a thief that takes it right away
+        // must not bring `pending` below zero
+        pending.fetch_add(1);
+
+        if ( auto inx { worker_index() }; inx >= 0 ) {
+            workers[inx]->tasks.push(item);
+        }
+        else {
+            std::scoped_lock lock { injected_mut };
+            injected.push_back(item);
+        }
+
+        wake_one();
+    }
+
+    void pool::wake_one() {
+        // A worker going to sleep bumps `sleepers` before checking `pending`,
+        // and we bumped `pending` before checking `sleepers`, so at least one
+        // side sees the other. Taking the lock makes sure a worker that saw
+        // nothing is already waiting when we notify.
+        if ( sleepers.load() > 0 ) {
+            { std::scoped_lock lock { sleep_mut }; }
+            sleep_cv.notify_one();
+        }
+    }
+
+    task* pool::find_work(size_t inx) {
+        task* found { nullptr };
+
+        if ( inx < workers.size() ) {
+            found = workers[inx]->tasks.take();
+        }
+
+        // steal, starting from a different victim each time to spread out
+        // the contention
+        thread_local size_t victim { inx };
+        for ( size_t k = 0; !found && k < workers.size(); ++k ) {
+            victim = (victim + 1) % workers.size();
+            if ( victim != inx ) {
+                found = workers[victim]->tasks.steal();
+            }
+        }
+
+        if ( !found ) {
+            std::scoped_lock lock { injected_mut };
+            if ( !injected.empty() ) {
+                found = injected.front();
+                injected.pop_front();
+            }
+        }
+
+        if ( found ) {
+            pending.fetch_sub(1);
+        }
+
+        return found;
+    }
+
+    void pool::execute(task* t) {
+        auto               group { t->group };
+        std::exception_ptr error {};
+
+        if ( group ) {
+            try {
+                t->fn();
+            }
+            catch ( ... ) {
+                error = std::current_exception();
+            }
+        }
+        else {
+            // tasks without a group have nobody to report to
+            t->fn();
+        }
+
+        delete t;
+
+        // the group may be gone as soon as it is told the task finished
+        if ( group ) group->finish(error);
+    }
+
+    void pool::worker_loop(size_t inx, std::string name) {
+        std::this_thread::set_name(name + " " + std::to_string(inx));
+
+        current_pool  = this;
+        current_index = static_cast<int>(inx);
+
+        while ( !stopping ) {
+            if ( auto t { find_work(inx) } ) {
+                execute(t);
+                continue;
+            }
+
+            std::unique_lock lock { sleep_mut };
+            sleepers.fetch_add(1);
+            sleep_cv.wait(lock,
+                          [this] { return pending.load() > 0 || stopping; });
+            sleepers.fetch_sub(1);
+        }
+    }
+
+    bool pool::try_run_one() {
+        const auto inx { worker_index() };
+        auto       t { find_work(inx >= 0 ? inx : workers.size()) };
+
+        if ( t ) execute(t);
+
+        return t != nullptr;
+    }
+
+    int pool::worker_index() const {
+        return current_pool == this ? current_index : -1;
+    }
+
+    pool& pool::shared() {
+        static pool instance {};
+        return instance;
+    }
+
+    // class task_group
+    task_group::task_group(pool& p)
+      : owner { p } {}
+
+    task_group::~task_group() {
+        // can't throw from here, whoever cared about errors called wait()
+        while ( pending.load(std::memory_order_acquire) != 0 ) {
+            if ( !owner.try_run_one() ) std::this_thread::yield();
+        }
+    }
+
+    void task_group::finish(std::exception_ptr err) {
+        if ( err ) {
+            std::scoped_lock lock { error_mut };
+            if ( !error ) error = err;
+        }
+        pending.fetch_sub(1, std::memory_order_release);
+    }
+
+    void task_group::wait() {
+        while ( pending.load(std::memory_order_acquire) != 0 ) {
+            if ( !owner.try_run_one() ) std::this_thread::yield();
+        }
+
+        std::exception_ptr err {};
+        {
+            std::scoped_lock lock { error_mut };
+            std::swap(err, error);
+        }
+
+        if ( err ) std::rethrow_exception(err);
+    }
+
+}  // namespace potato::jobs
@@ -0,0 +1,157 @@
+#ifndef POTATO_CORE_JOBS_HPP
+#define POTATO_CORE_JOBS_HPP
+
+#include "chase_lev.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace potato::jobs {
+
+    class task_group;
+
+    // Tasks pushed without a group must not throw
+    struct task {
+        std::function<void()> fn {};
+        task_group*           group {};
+    };
+
+    // Fixed set of worker threads, each with its own work-stealing deque.
+    // Tasks pushed from a worker go to that worker's deque, tasks pushed from
+    // any other thread go to a shared queue. Idle workers steal from the
+    // others before going to sleep.
+    class pool {
+      private:
+        struct worker {
+            chase_lev_deque<task> tasks {};
+            std::jthread          thread {};
+        };
+
+        std::vector<std::unique_ptr<worker>> workers {};
+
+        // tasks submitted from outside the pool
+        std::mutex        injected_mut {};
+        std::deque<task*> injected {};
+
+        // number of queued tasks nobody has picked up yet
+        std::atomic<size_t>     pending { 0 };
+        std::atomic<bool>       stopping { false };
+        std::mutex              sleep_mut {};
+        std::condition_variable sleep_cv {};
+        std::atomic<size_t>     sleepers { 0 };
+
+        void  worker_loop(size_t inx, std::string name);
+        task* find_work(size_t inx);
+        void  execute(task*);
+        void  drop(task*);
+        void  wake_one();
+
+      public:
+        // 0 picks one worker per hardware thread, minus the calling thread
+        explicit pool(unsigned threads = 0, std::string name = "potato job");
+        ~pool();
+
+        // no copy, no move, workers hold on to it
+        pool(const pool&) = delete;
+        pool& operator=(const pool&) = delete;
+
+        void push(task);
+
+        // Runs one queued task on the calling thread, if there is one.
+        // Returns false if no work was found.
+        bool try_run_one();
+
+        // Index of the calling thread within this pool, or -1 if it is not
+        // one of its workers
+        int worker_index() const;
+
+        size_t size() const {
+            return workers.size();
+        }
+
+        // Process-wide pool, created on first use
+        static pool& shared();
+    };
+
+    // Set of tasks that can be waited on together. Waiting runs queued
+    // tasks instead of blocking, so a task can spawn and wait on a nested
+    // group without tying up a worker.
+    class task_group {
+      private:
+        friend class pool;
+
+        pool&               owner;
+        std::atomic<size_t> pending { 0 };
+        std::mutex          error_mut {};
+        std::exception_ptr  error {};
+
+        void finish(std::exception_ptr);
+
+      public:
+        explicit task_group(pool& p = pool::shared());
+        ~task_group();
+
+        // no copy, no move, tasks hold on to it
+        task_group(const task_group&) = delete;
+        task_group& operator=(const task_group&) = delete;
+
+        template<typename F>
+        void run(F&& fn) {
+            pending.fetch_add(1, std::memory_order_relaxed);
+            owner.push({ .fn = std::forward<F>(fn), .group = this });
+        }
+
+        // Returns once every task run through this group has finished.
+        // Rethrows the first exception a task threw.
+        void wait();
+    };
+
+    // Calls fn(i) for every i in [first, last), split into chunks of `grain`
+    // indices. A grain of 0 picks one that gives every worker several chunks
+    // to balance over.
+    template<typename F>
+    void parallel_for(size_t first,
+                      size_t last,
+                      F&&    fn,
+                      size_t grain = 0,
+                      pool&  p     = pool::shared()) {
+        if ( first >= last ) return;
+
+        const auto count { last - first };
+
+        if ( grain == 0 ) {
+            grain = std::max<size_t>(1, count / ((p.size() + 1) * 8));
+        }
+
+        if ( count <= grain || p.size() == 0 ) {
+            for ( auto i = first; i < last; ++i ) {
+                fn(i);
+            }
+            return;
+        }
+
+        task_group group { p };
+
+        for ( auto begin = first; begin < last; begin += grain ) {
+            const auto end { std::min(begin + grain, last) };
+            group.run([&fn, begin, end] {
+                for ( auto i = begin; i < end; ++i ) {
+                    fn(i);
+                }
+            });
+        }
+
+        group.wait();
+    }
+
+}  // namespace potato::jobs
+
+#endif
@@ -0,0 +1,147 @@
+#include "mapped_file.hpp"
+
+#include "platform.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#ifdef LINUX
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace potato::utils {
+
+#if defined(WINDOWS)
+    mapped_file::mapped_file(const std::string& fname) {
+        file = ::CreateFileA(fname.c_str(),
+                             GENERIC_READ,
+                             FILE_SHARE_READ,
+                             nullptr,
+                             OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL,
+                             nullptr);
+
+        if ( file == INVALID_HANDLE_VALUE ) {
+            file = nullptr;
+            throw std::runtime_error("Could not open file for mapping");
+        }
+
+        LARGE_INTEGER file_size {};
+        ::GetFileSizeEx(file, &file_size);
+        length = static_cast<size_t>(file_size.QuadPart);
+
+        // empty files cannot be mapped, and need not be
+        if ( length == 0 ) return;
+
+        mapping = ::CreateFileMappingA(
+          file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if ( mapping ) {
+            view = static_cast<const std::byte*>(
+              ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+
+        if ( !view ) {
+            close();
+            throw std::runtime_error("Could not map file");
+        }
+    }
+
+    void mapped_file::close() {
+        if ( view ) ::UnmapViewOfFile(view);
+        if ( mapping ) ::CloseHandle(mapping);
+        if ( file ) ::CloseHandle(file);
+
+        view    = nullptr;
+        mapping = nullptr;
+        file    = nullptr;
+        length  = 0;
+    }
+#elif defined(LINUX)
+    mapped_file::mapped_file(const std::string& fname) {
+        const int fd { ::open(fname.c_str(), O_RDONLY) };
+        if ( fd < 0 ) {
+            throw std::runtime_error("Could not open file for mapping");
+        }
+
+        struct stat info {};
+        if ( ::fstat(fd, &info) != 0 ) {
+            ::close(fd);
+            throw std::runtime_error("Could not read file size");
+        }
+        length = static_cast<size_t>(info.st_size);
+
+        // the mapping keeps its own reference to the file
+        void* addr { length != 0 ? ::mmap(nullptr,
+                                          length,
+                                          PROT_READ,
+                                          MAP_PRIVATE,
+                                          fd,
+                                          0)
+                                 : nullptr };
+        ::close(fd);
+
+        if ( addr == MAP_FAILED ) {
+            throw std::runtime_error("Could not map file");
+        }
+
+        view    = static_cast<const std::byte*>(addr);
+        mapping = addr;
+    }
+
+    void mapped_file::close() {
+        if ( mapping ) ::munmap(mapping, length);
+
+        view    = nullptr;
+        mapping = nullptr;
+        length  = 0;
+    }
+#else
+    mapped_file::mapped_file(const std::string& fname) {
+        std::ifstream in { fname, std::ios::binary | std::ios::ate };
+        if ( !in.is_open() ) {
+            throw std::runtime_error("Could not open file for reading");
+        }
+
+        buffer.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        in.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+
+        view   = buffer.data();
+        length = buffer.size();
+    }
+
+    void mapped_file::close() {
+        buffer.clear();
+        view   = nullptr;
+        length = 0;
+    }
+#endif
+
+    mapped_file::~mapped_file() {
+        close();
+    }
+
+    mapped_file::mapped_file(mapped_file&& other) noexcept
+      : view { std::exchange(other.view, nullptr) }
+      , length { std::exchange(other.length, 0) }
+      , file { std::exchange(other.file, nullptr) }
+      , mapping { std::exchange(other.mapping, nullptr) }
+      , buffer { std::move(other.buffer) } {}
+
+    mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+        if ( this != &other ) {
+            close();
+            view    = std::exchange(other.view, nullptr);
+            length  = std::exchange(other.length, 0);
+            file    = std::exchange(other.file, nullptr);
+            mapping = std::exchange(other.mapping, nullptr);
+            buffer  = std::move(other.buffer);
+        }
+        return *this;
+    }
+
+}  // namespace potato::utils
@@ -0,0 +1,52 @@
+#ifndef POTATO_CORE_MAPPED_FILE_HPP
+#define POTATO_CORE_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace potato::utils {
+
+    // Read-only view of a whole file, memory mapped where the platform
+    // allows it, so pages are only read in as they are touched. Platforms
+    // without a mapping fall back to reading the file into memory.
+    class mapped_file {
+      private:
+        const std::byte* view {};
+        size_t           length {};
+
+        // platform handles of the mapping
+        void* file {};
+        void* mapping {};
+
+        // used instead of a mapping by the fallback
+        std::vector<std::byte> buffer {};
+
+        void close();
+
+      public:
+        // Throws std::runtime_error if the file cannot be opened or mapped
+        explicit mapped_file(const std::string& fname);
+        ~mapped_file();
+
+        // no copy
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        // allow move
+        mapped_file(mapped_file&&) noexcept;
+        mapped_file& operator=(mapped_file&&) noexcept;
+
+        std::span<const std::byte> bytes() const {
+            return { view, length };
+        }
+
+        size_t size() const {
+            return length;
+        }
+    };
+
+}  // namespace potato::utils
+
+#endif
@@ -0,0 +1,55 @@
+#include "memory.hpp"
+
+#include "platform.h"
+
+#include <algorithm>
+#include <new>
+
+#ifdef LINUX
+#    include <sys/mman.h>
+#endif
+
+namespace {
+    bool wants_huge(size_t bytes, bool huge) {
+        return huge && bytes >= potato::memory::huge_page;
+    }
+
+    std::align_val_t alignment(size_t bytes, size_t align, bool huge) {
+        using namespace potato::memory;
+
+        const auto base { wants_huge(bytes, huge) ? huge_page : cache_line };
+        return std::align_val_t { std::max(base, align) };
+    }
+
+    size_t padded(size_t bytes, bool huge) {
+        if ( !wants_huge(bytes, huge) ) return bytes;
+
+        constexpr auto page { potato::memory::huge_page };
+        return (bytes + page - 1) / page * page;
+    }
+}  // namespace
+
+namespace potato::memory {
+
+    void* allocate_block(size_t bytes, size_t align, bool huge) {
+        const auto size { padded(bytes, huge) };
+        const auto where { alignment(bytes, align, huge) };
+        auto       block { ::operator new(size, where) };
+
+#if defined(LINUX) && defined(MADV_HUGEPAGE)
+        // only a hint, the kernel may still use regular pages
+        if ( wants_huge(bytes, huge) ) {
+            ::madvise(block, size, MADV_HUGEPAGE);
+        }
+#endif
+
+        return block;
+    }
+
+    void free_block(void* block, size_t bytes, size_t align, bool huge) {
+        ::operator delete(block,
+                          padded(bytes, huge),
+                          alignment(bytes, align, huge));
+    }
+
+}  // namespace potato::memory
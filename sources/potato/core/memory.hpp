@@ -0,0 +1,24 @@
+#ifndef POTATO_CORE_MEMORY_HPP
+#define POTATO_CORE_MEMORY_HPP
+
+#include <cstddef>
+
+namespace potato::memory {
+
+    inline constexpr size_t cache_line = 64;
+    inline constexpr size_t huge_page  = size_t(2) << 20;
+
+    // Raw block of at least `bytes`, aligned to a cache line or `align`,
+    // whichever is stricter. With `huge` set, blocks of at least huge_page
+    // are aligned and padded to whole huge pages, and on Linux the kernel
+    // is asked to back them with transparent huge pages. Windows only hands
+    // out large pages to privileged processes, there `huge` is ignored.
+    // Throws std::bad_alloc
+    void* allocate_block(size_t bytes, size_t align, bool huge = false);
+
+    // Frees a block, with the same arguments it was allocated with
+    void free_block(void* block, size_t bytes, size_t align, bool huge = false);
+
+}  // namespace potato::memory
+
+#endif
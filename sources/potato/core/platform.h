@@ -8,6 +8,9 @@
 #endif
 
 #ifdef WINDOWS
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
 #    define WIN32_LEAN_AND_MEAN
 #    include <Windows.h>
 #endif
@@ -0,0 +1,21 @@
+#ifndef POTATO_CORE_SIMD_HPP
+#define POTATO_CORE_SIMD_HPP
+
+// For the translation units of the SIMD batch kernels. POTATO_X86 is set
+// where SSE and AVX intrinsics exist, POTATO_TARGET(isa) lets a single
+// function use instructions beyond the ones the build targets. Which ones
+// the machine has is potato::math::active_simd_level(), see trs.hpp
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    define POTATO_X86
+#    include <immintrin.h>
+#    if defined(_MSC_VER) && !defined(__clang__)
+#        include <intrin.h>
+// MSVC lets any function use any intrinsic
+#        define POTATO_TARGET(isa)
+#    else
+#        define POTATO_TARGET(isa) __attribute__((target(isa)))
+#    endif
+#endif
+
+#endif
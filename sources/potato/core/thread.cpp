@@ -5,12 +5,31 @@
 #include <iostream>
 #include <thread>
 
+#ifdef LINUX
+#    include <pthread.h>
+#endif
+
 namespace {
 #if defined(WINDOWS) && defined(NTDDI_WIN10_RS1)
     bool platform_set_thread_name(const std::string& name) {
         const std::wstring a { name.cbegin(), name.cend() };
         return !FAILED(SetThreadDescription(::GetCurrentThread(), a.c_str()));
     }
+#elif defined(__APPLE__)
+    bool platform_set_thread_name(const std::string& name) {
+        // macOS can only name the calling thread
+        return pthread_setname_np(name.substr(0, 63).c_str()) == 0;
+    }
+#elif defined(LINUX)
+    bool platform_set_thread_name(const std::string& name) {
+        // Linux limits names to 16 bytes, including the terminator
+        return pthread_setname_np(::pthread_self(), name.substr(0, 15).c_str())
+            == 0;
+    }
+#else
+    bool platform_set_thread_name(const std::string&) {
+        return false;
+    }
 #endif
 
 }  // namespace
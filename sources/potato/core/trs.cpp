@@ -0,0 +1,308 @@
+#include "trs.hpp"
+
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+    using potato::math::simd_level;
+    using potato::math::trs_view;
+
+    simd_level detect_simd_level() {
+#if defined(POTATO_X86) && defined(_MSC_VER) && !defined(__clang__)
+        int regs[4] {};
+
+        __cpuid(regs, 1);
+        const bool sse4 { (regs[2] & (1 << 19)) != 0 };
+        const bool osxsave { (regs[2] & (1 << 27)) != 0 };
+
+        // the OS must also save the upper halves of the ymm registers
+        const bool ymm { osxsave && (_xgetbv(0) & 0x6) == 0x6 };
+
+        __cpuidex(regs, 7, 0);
+        const bool avx2 { (regs[1] & (1 << 5)) != 0 };
+
+        if ( avx2 && ymm ) return simd_level::avx2;
+        if ( sse4 ) return simd_level::sse4;
+#elif defined(POTATO_X86)
+        __builtin_cpu_init();
+        if ( __builtin_cpu_supports("avx2") ) return simd_level::avx2;
+        if ( __builtin_cpu_supports("sse4.1") ) return simd_level::sse4;
+#endif
+        return simd_level::scalar;
+    }
+
+    // One transform, with an optional projection-view matrix in front
+    void batch_scalar(const glm::mat4* pv,
+                      const trs_view&  in,
+                      glm::mat4*       out,
+                      size_t           first) {
+        for ( auto i { first }; i < in.size(); ++i ) {
+            const auto m { potato::math::trs_to_mat4(
+              { in.tx[i], in.ty[i], in.tz[i] },
+              glm::quat { in.qw[i], in.qx[i], in.qy[i], in.qz[i] },
+              { in.sx[i], in.sy[i], in.sz[i] }) };
+
+            out[i] = pv ? *pv * m : m;
+        }
+    }
+
+#ifdef POTATO_X86
+    // The SIMD kernels hold the matrices of 4 or 8 transforms at once, one
+    // register per matrix entry, m[column][row] with a lane per transform.
+    // They are written back by transposing 4x4 blocks of those registers.
+
+    POTATO_TARGET("sse4.1")
+    void store_columns(__m128 r0, __m128 r1, __m128 r2, __m128 r3,
+                       glm::mat4* out, int column) {
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(&out[0][column][0], r0);
+        _mm_storeu_ps(&out[1][column][0], r1);
+        _mm_storeu_ps(&out[2][column][0], r2);
+        _mm_storeu_ps(&out[3][column][0], r3);
+    }
+
+    POTATO_TARGET("sse4.1")
+    size_t batch_sse4(const glm::mat4* pv, const trs_view& in, glm::mat4* out) {
+        const size_t n { in.size() & ~size_t(3) };
+
+        const __m128 zero { _mm_setzero_ps() };
+        const __m128 one { _mm_set1_ps(1.f) };
+        const __m128 two { _mm_set1_ps(2.f) };
+
+        for ( size_t i = 0; i < n; i += 4 ) {
+            const __m128 qx { _mm_loadu_ps(&in.qx[i]) };
+            const __m128 qy { _mm_loadu_ps(&in.qy[i]) };
+            const __m128 qz { _mm_loadu_ps(&in.qz[i]) };
+            const __m128 qw { _mm_loadu_ps(&in.qw[i]) };
+            const __m128 sx { _mm_loadu_ps(&in.sx[i]) };
+            const __m128 sy { _mm_loadu_ps(&in.sy[i]) };
+            const __m128 sz { _mm_loadu_ps(&in.sz[i]) };
+
+            const __m128 xx { _mm_mul_ps(qx, qx) };
+            const __m128 yy { _mm_mul_ps(qy, qy) };
+            const __m128 zz { _mm_mul_ps(qz, qz) };
+            const __m128 xy { _mm_mul_ps(qx, qy) };
+            const __m128 xz { _mm_mul_ps(qx, qz) };
+            const __m128 yz { _mm_mul_ps(qy, qz) };
+            const __m128 wx { _mm_mul_ps(qw, qx) };
+            const __m128 wy { _mm_mul_ps(qw, qy) };
+            const __m128 wz { _mm_mul_ps(qw, qz) };
+
+            __m128 m[4][4] {
+                { _mm_mul_ps(
+                    _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+                  _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+                  _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+                  zero },
+                { _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+                  _mm_mul_ps(
+                    _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+                  _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+                  zero },
+                { _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+                  _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+                  _mm_mul_ps(
+                    _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+                  zero },
+                { _mm_loadu_ps(&in.tx[i]),
+                  _mm_loadu_ps(&in.ty[i]),
+                  _mm_loadu_ps(&in.tz[i]),
+                  one },
+            };
+
+            if ( pv ) {
+                __m128 p[4][4] {};
+
+                for ( int c = 0; c < 4; ++c ) {
+                    for ( int r = 0; r < 4; ++r ) {
+                        // the last row of m is 0 0 0 1
+                        __m128 sum { c == 3 ? _mm_set1_ps((*pv)[3][r]) : zero };
+                        for ( int k = 0; k < 3; ++k ) {
+                            sum = _mm_add_ps(
+                              sum,
+                              _mm_mul_ps(_mm_set1_ps((*pv)[k][r]), m[c][k]));
+                        }
+                        p[c][r] = sum;
+                    }
+                }
+
+                std::copy(&p[0][0], &p[0][0] + 16, &m[0][0]);
+            }
+
+            for ( int c = 0; c < 4; ++c ) {
+                store_columns(m[c][0], m[c][1], m[c][2], m[c][3], out + i, c);
+            }
+        }
+
+        return n;
+    }
+
+    POTATO_TARGET("avx2")
+    size_t batch_avx2(const glm::mat4* pv, const trs_view& in, glm::mat4* out) {
+        const size_t n { in.size() & ~size_t(7) };
+
+        const __m256 zero { _mm256_setzero_ps() };
+        const __m256 one { _mm256_set1_ps(1.f) };
+        const __m256 two { _mm256_set1_ps(2.f) };
+
+        for ( size_t i = 0; i < n; i += 8 ) {
+            const __m256 qx { _mm256_loadu_ps(&in.qx[i]) };
+            const __m256 qy { _mm256_loadu_ps(&in.qy[i]) };
+            const __m256 qz { _mm256_loadu_ps(&in.qz[i]) };
+            const __m256 qw { _mm256_loadu_ps(&in.qw[i]) };
+            const __m256 sx { _mm256_loadu_ps(&in.sx[i]) };
+            const __m256 sy { _mm256_loadu_ps(&in.sy[i]) };
+            const __m256 sz { _mm256_loadu_ps(&in.sz[i]) };
+
+            const __m256 xx { _mm256_mul_ps(qx, qx) };
+            const __m256 yy { _mm256_mul_ps(qy, qy) };
+            const __m256 zz { _mm256_mul_ps(qz, qz) };
+            const __m256 xy { _mm256_mul_ps(qx, qy) };
+            const __m256 xz { _mm256_mul_ps(qx, qz) };
+            const __m256 yz { _mm256_mul_ps(qy, qz) };
+            const __m256 wx { _mm256_mul_ps(qw, qx) };
+            const __m256 wy { _mm256_mul_ps(qw, qy) };
+            const __m256 wz { _mm256_mul_ps(qw, qz) };
+
+            __m256 m[4][4] {
+                { _mm256_mul_ps(
+                    _mm256_sub_ps(one,
+                                  _mm256_mul_ps(two, _mm256_add_ps(yy, zz))),
+                    sx),
+                  _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx),
+                  _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx),
+                  zero },
+                { _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy),
+                  _mm256_mul_ps(
+                    _mm256_sub_ps(one,
+                                  _mm256_mul_ps(two, _mm256_add_ps(xx, zz))),
+                    sy),
+                  _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy),
+                  zero },
+                { _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz),
+                  _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz),
+                  _mm256_mul_ps(
+                    _mm256_sub_ps(one,
+                                  _mm256_mul_ps(two, _mm256_add_ps(xx, yy))),
+                    sz),
+                  zero },
+                { _mm256_loadu_ps(&in.tx[i]),
+                  _mm256_loadu_ps(&in.ty[i]),
+                  _mm256_loadu_ps(&in.tz[i]),
+                  one },
+            };
+
+            if ( pv ) {
+                __m256 p[4][4] {};
+
+                for ( int c = 0; c < 4; ++c ) {
+                    for ( int r = 0; r < 4; ++r ) {
+                        // the last row of m is 0 0 0 1
+                        __m256 sum { c == 3 ? _mm256_set1_ps((*pv)[3][r])
+                                            : zero };
+                        for ( int k = 0; k < 3; ++k ) {
+                            sum = _mm256_add_ps(
+                              sum,
+                              _mm256_mul_ps(_mm256_set1_ps((*pv)[k][r]),
+                                            m[c][k]));
+                        }
+                        p[c][r] = sum;
+                    }
+                }
+
+                std::copy(&p[0][0], &p[0][0] + 16, &m[0][0]);
+            }
+
+            // low lanes are transforms i..i+3, high lanes i+4..i+7
+            for ( int c = 0; c < 4; ++c ) {
+                store_columns(_mm256_castps256_ps128(m[c][0]),
+                              _mm256_castps256_ps128(m[c][1]),
+                              _mm256_castps256_ps128(m[c][2]),
+                              _mm256_castps256_ps128(m[c][3]),
+                              out + i,
+                              c);
+                store_columns(_mm256_extractf128_ps(m[c][0], 1),
+                              _mm256_extractf128_ps(m[c][1], 1),
+                              _mm256_extractf128_ps(m[c][2], 1),
+                              _mm256_extractf128_ps(m[c][3], 1),
+                              out + i + 4,
+                              c);
+            }
+        }
+
+        return n;
+    }
+#endif
+
+    void batch(const glm::mat4* pv, const trs_view& in, glm::mat4* out) {
+        size_t done {};
+
+#ifdef POTATO_X86
+        switch ( potato::math::active_simd_level() ) {
+            case simd_level::avx2:
+                done = batch_avx2(pv, in, out);
+                break;
+            case simd_level::sse4:
+                done = batch_sse4(pv, in, out);
+                break;
+            case simd_level::scalar:
+                break;
+        }
+#endif
+
+        // whatever did not fill a whole register
+        batch_scalar(pv, in, out, done);
+    }
+}  // namespace
+
+namespace potato::math {
+
+    simd_level active_simd_level() {
+        static const simd_level level { detect_simd_level() };
+        return level;
+    }
+
+    void trs_buffer::resize(size_t n) {
+        for ( auto v : { &tx, &ty, &tz, &qx, &qy, &qz, &qw, &sx, &sy, &sz } ) {
+            v->resize(n);
+        }
+    }
+
+    trs_view trs_buffer::view() const {
+        return { tx, ty, tz, qx, qy, qz, qw, sx, sy, sz };
+    }
+
+    void trs_to_mat4(const trs_view& in, std::span<glm::mat4> out) {
+        assert(out.size() >= in.size());
+        batch(nullptr, in, out.data());
+    }
+
+    void trs_to_mat4(const glm::mat4&     projection_view,
+                     const trs_view&      in,
+                     std::span<glm::mat4> out) {
+        assert(out.size() >= in.size());
+        batch(&projection_view, in, out.data());
+    }
+
+    glm::quat euler_to_quat(const glm::vec3& euler_angles) {
+        // yawPitchRoll rotates by roll about z, then pitch about x, then yaw
+        // about y, so the quaternion is q(yaw) * q(pitch) * q(roll)
+        const float cy { std::cos(euler_angles.y * .5f) };
+        const float sy { std::sin(euler_angles.y * .5f) };
+        const float cp { std::cos(euler_angles.x * .5f) };
+        const float sp { std::sin(euler_angles.x * .5f) };
+        const float cr { std::cos(euler_angles.z * .5f) };
+        const float sr { std::sin(euler_angles.z * .5f) };
+
+        return glm::quat {
+            cy * cp * cr + sy * sp * sr,
+            cy * sp * cr + sy * cp * sr,
+            sy * cp * cr - cy * sp * sr,
+            cy * cp * sr - sy * sp * cr,
+        };
+    }
+
+}  // namespace potato::math
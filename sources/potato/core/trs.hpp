@@ -0,0 +1,110 @@
+#ifndef POTATO_CORE_TRS_HPP
+#define POTATO_CORE_TRS_HPP
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace potato::math {
+
+    // Instruction set the batch kernels below picked for this machine
+    enum class simd_level {
+        scalar,
+        sse4,
+        avx2,
+    };
+
+    simd_level active_simd_level();
+
+    // Non-owning structure-of-arrays view of translation, rotation and
+    // scale. Every span holds `size()` floats, element i of each span
+    // belongs to transform i.
+    struct trs_view {
+        std::span<const float> tx, ty, tz;
+        std::span<const float> qx, qy, qz, qw;
+        std::span<const float> sx, sy, sz;
+
+        size_t size() const {
+            return tx.size();
+        }
+    };
+
+    // Owning structure-of-arrays storage for trs_view, meant to be kept
+    // around and refilled every frame
+    class trs_buffer {
+      private:
+        std::vector<float> tx, ty, tz;
+        std::vector<float> qx, qy, qz, qw;
+        std::vector<float> sx, sy, sz;
+
+      public:
+        void resize(size_t n);
+
+        void set(size_t           i,
+                 const glm::vec3& translation,
+                 const glm::quat& rotation,
+                 const glm::vec3& scale) {
+            tx[i] = translation.x;
+            ty[i] = translation.y;
+            tz[i] = translation.z;
+
+            qx[i] = rotation.x;
+            qy[i] = rotation.y;
+            qz[i] = rotation.z;
+            qw[i] = rotation.w;
+
+            sx[i] = scale.x;
+            sy[i] = scale.y;
+            sz[i] = scale.z;
+        }
+
+        size_t size() const {
+            return tx.size();
+        }
+
+        trs_view view() const;
+    };
+
+    // out[i] = translate(t[i]) * toMat4(q[i]) * scale(s[i]), for every
+    // transform in `in`. `out` must be at least in.size() long
+    void trs_to_mat4(const trs_view& in, std::span<glm::mat4> out);
+
+    // Same, premultiplied by `projection_view`, which gives the final clip
+    // space matrix of every object in one pass
+    void trs_to_mat4(const glm::mat4&      projection_view,
+                     const trs_view&       in,
+                     std::span<glm::mat4> out);
+
+    // Single transform version of the above, cheaper than multiplying the
+    // three matrices out
+    inline glm::mat4 trs_to_mat4(const glm::vec3& t,
+                                 const glm::quat& q,
+                                 const glm::vec3& s) {
+        const float xx { q.x * q.x }, yy { q.y * q.y }, zz { q.z * q.z };
+        const float xy { q.x * q.y }, xz { q.x * q.z }, yz { q.y * q.z };
+        const float wx { q.w * q.x }, wy { q.w * q.y }, wz { q.w * q.z };
+
+        glm::mat4 m { 1.f };
+        m[0] = { (1 - 2 * (yy + zz)) * s.x,
+                 2 * (xy + wz) * s.x,
+                 2 * (xz - wy) * s.x,
+                 0.f };
+        m[1] = { 2 * (xy - wz) * s.y,
+                 (1 - 2 * (xx + zz)) * s.y,
+                 2 * (yz + wx) * s.y,
+                 0.f };
+        m[2] = { 2 * (xz + wy) * s.z,
+                 2 * (yz - wx) * s.z,
+                 (1 - 2 * (xx + yy)) * s.z,
+                 0.f };
+        m[3] = { t.x, t.y, t.z, 1.f };
+        return m;
+    }
+
+    // The rotation glm::yawPitchRoll(e.y, e.x, e.z) describes, built as a
+    // quaternion directly instead of going through a matrix
+    glm::quat euler_to_quat(const glm::vec3& euler_angles);
+
+}  // namespace potato::math
+
+#endif
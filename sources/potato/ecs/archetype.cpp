@@ -0,0 +1,178 @@
+#include "archetype.hpp"
+
+#include <algorithm>
+
+namespace {
+    size_t align_up(size_t offset, size_t alignment) {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+}  // namespace
+
+namespace ecs {
+
+    // class archetype
+    archetype::archetype(signature s, std::vector<component_info> components)
+      : sig { s }
+      , infos { std::move(components) } {
+
+        std::ranges::sort(infos, {}, &component_info::bit);
+
+        // infos are sorted, the last one has the highest bit
+        column_of.assign(infos.empty() ? 0 : infos.back().bit + 1, -1);
+        offsets.resize(infos.size());
+
+        size_t row_size { sizeof(entity_id) };
+        for ( auto i = 0u; i < infos.size(); ++i ) {
+            assert(infos[i].align <= alignof(chunk));
+            column_of[infos[i].bit] = static_cast<int16_t>(i);
+            row_size += infos[i].size;
+        }
+
+        // Start with the densest packing, and back off one row at a time
+        // until the padding needed to align every column fits too
+        for ( capacity = chunk::size / row_size; capacity > 0; --capacity ) {
+            size_t offset { sizeof(entity_id) * capacity };
+
+            for ( auto i = 0u; i < infos.size(); ++i ) {
+                offset     = align_up(offset, infos[i].align);
+                offsets[i] = offset;
+                offset += infos[i].size * capacity;
+            }
+
+            if ( offset <= chunk::size ) break;
+        }
+
+        assert(capacity > 0 && "Components too large to fit in a chunk");
+    }
+
+    archetype::~archetype() {
+        for ( auto& c : chunks ) {
+            for ( auto col = 0u; col < infos.size(); ++col ) {
+                for ( uint32_t row = 0; row < c->count; ++row ) {
+                    infos[col].destroy(at(*c, col, row));
+                }
+            }
+        }
+    }
+
+    location archetype::emplace(entity_id eid) {
+        if ( chunks.empty() || chunks.back()->count == capacity ) {
+            // default-init, no need to zero the whole block
+            chunks.emplace_back(new chunk);
+        }
+
+        auto& c { *chunks.back() };
+        auto  row { c.count++ };
+
+        ids(c)[row] = eid;
+
+        return { static_cast<uint32_t>(chunks.size() - 1), row };
+    }
+
+    entity_id archetype::erase(location loc) {
+        auto& c { *chunks[loc.chunk] };
+        auto& last { *chunks.back() };
+        auto  last_row { last.count - 1 };
+
+        entity_id moved {};
+
+        for ( auto col = 0u; col < infos.size(); ++col ) {
+            infos[col].destroy(at(c, col, loc.row));
+        }
+
+        // fill the hole with the last row, unless it is the last row
+        if ( &c != &last || loc.row != last_row ) {
+            for ( auto col = 0u; col < infos.size(); ++col ) {
+                infos[col].move_construct(at(c, col, loc.row),
+                                          at(last, col, last_row));
+                infos[col].destroy(at(last, col, last_row));
+            }
+
+            moved           = ids(last)[last_row];
+            ids(c)[loc.row] = moved;
+        }
+
+        if ( --last.count == 0 ) {
+            chunks.pop_back();
+        }
+
+        return moved;
+    }
+
+    void archetype::move_from(archetype& src, location src_loc, location dst) {
+        auto& c { *chunks[dst.chunk] };
+
+        for ( auto col = 0u; col < infos.size(); ++col ) {
+            if ( src.has(infos[col].bit) ) {
+                infos[col].move_construct(at(c, col, dst.row),
+                                          src.get(infos[col].bit, src_loc));
+            }
+        }
+    }
+
+    size_t archetype::size() const {
+        return chunks.empty()
+               ? 0
+               : (chunks.size() - 1) * capacity + chunks.back()->count;
+    }
+
+    // class archetype_storage
+    archetype_storage::record& archetype_storage::record_of(entity_id eid) {
+        if ( eid.index >= records.size() ) {
+            records.resize(eid.index + 1);
+        }
+        return records[eid.index];
+    }
+
+    archetype& archetype_storage::find_or_create(const signature& sig) {
+        if ( auto it { archetypes.find(sig) }; it != archetypes.end() ) {
+            return *it->second;
+        }
+
+        std::vector<component_info> components {};
+        sig.for_each([&](size_t bit) { components.push_back(infos.at(bit)); });
+
+        auto [it, _] { archetypes.emplace(
+          sig,
+          std::make_unique<archetype>(sig, std::move(components))) };
+
+        return *it->second;
+    }
+
+    archetype_storage::record& archetype_storage::move(entity_id        eid,
+                                                       const signature& to) {
+        auto& rec { record_of(eid) };
+        auto  from { rec.arch };
+        auto  from_loc { rec.loc };
+
+        rec = {};
+
+        if ( to.any() ) {
+            auto& dst { find_or_create(to) };
+
+            rec.arch = &dst;
+            rec.loc  = dst.emplace(eid);
+
+            if ( from ) {
+                dst.move_from(*from, from_loc, rec.loc);
+            }
+        }
+
+        // the components left behind are either moved-from or the ones being
+        // removed, destroy them and patch the entity that filled the hole
+        if ( from ) {
+            if ( auto moved { from->erase(from_loc) }; moved ) {
+                records[moved.index].loc = from_loc;
+            }
+        }
+
+        return rec;
+    }
+
+    void archetype_storage::remove(entity_id eid) {
+        if ( eid.index < records.size() && records[eid.index].arch ) {
+            move(eid, signature {});
+        }
+    }
+
+}  // namespace ecs
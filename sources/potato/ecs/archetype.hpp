@@ -0,0 +1,257 @@
+#ifndef POTATO_ECS_ARCHETYPE_HPP
+#define POTATO_ECS_ARCHETYPE_HPP
+
+#include "utils.hpp"
+
+#include <cassert>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace ecs {
+
+    // Type-erased description of a component, enough for an archetype to
+    // lay out a column and move values between columns
+    struct component_info {
+        size_t bit {};
+        size_t size {};
+        size_t align {};
+        void (*move_construct)(void* dst, void* src) {};
+        void (*destroy)(void* obj) {};
+
+        template<component_type T>
+        static component_info of() {
+            return {
+                .bit            = type_id<T>(),
+                .size           = sizeof(T),
+                .align          = alignof(T),
+                .move_construct = [](void* dst, void* src) {
+                    new (dst) T(std::move(*static_cast<T*>(src)));
+                },
+                .destroy = [](void* obj) { static_cast<T*>(obj)->~T(); },
+            };
+        }
+    };
+
+    // Fixed-size block of memory holding `count` entities of one archetype.
+    // The block starts with the column of entity ids, followed by one column
+    // per component, each `capacity` entries long.
+    struct chunk {
+        static constexpr size_t size = 16 * 1024;
+
+        alignas(64) std::byte data[size];
+        uint32_t count { 0 };
+    };
+
+    // Location of an entity's components inside an archetype
+    struct location {
+        uint32_t chunk {};
+        uint32_t row {};
+    };
+
+    // All entities with exactly the same set of components. Chunks are kept
+    // packed, only the last chunk can have free rows.
+    class archetype {
+      private:
+        signature                           sig {};
+        std::vector<component_info>         infos {};
+        std::vector<size_t>                 offsets {};
+        std::vector<int16_t>                column_of {};
+        uint32_t                            capacity {};
+        std::vector<std::unique_ptr<chunk>> chunks {};
+
+        std::byte* at(chunk& c, size_t column, uint32_t row) const {
+            return c.data + offsets[column] + infos[column].size * row;
+        }
+
+      public:
+        archetype(signature, std::vector<component_info>);
+
+        // no copy
+        archetype(const archetype&) = delete;
+        archetype& operator=(const archetype&) = delete;
+
+        // allow move
+        archetype(archetype&&) = default;
+        archetype& operator=(archetype&&) = default;
+
+        ~archetype();
+
+        const signature& get_signature() const {
+            return sig;
+        }
+
+        const std::vector<component_info>& get_infos() const {
+            return infos;
+        }
+
+        bool has(size_t bit) const {
+            return sig.test(bit);
+        }
+
+        // Reserves a row for `eid`. The component slots of the row are left
+        // unconstructed, the caller must construct every column
+        location emplace(entity_id eid);
+
+        // Destroys the components at `loc` and fills the hole with the last
+        // row. Returns the id of the entity that was moved into `loc`, or a
+        // null id if nothing moved.
+        entity_id erase(location loc);
+
+        // Moves the components in `loc` of `src` that this archetype also has
+        // into `dst`. Components `src` does not have are left unconstructed.
+        void move_from(archetype& src, location src_loc, location dst);
+
+        void* get(size_t bit, location loc) {
+            assert(has(bit));
+            return at(*chunks[loc.chunk], column_of[bit], loc.row);
+        }
+
+        size_t size() const;
+
+        std::span<const std::unique_ptr<chunk>> get_chunks() const {
+            return chunks;
+        }
+
+        std::span<entity_id> ids(chunk& c) const {
+            return { reinterpret_cast<entity_id*>(c.data), c.count };
+        }
+
+        template<component_type T>
+        T* column(chunk& c) const {
+            assert(has(type_id<T>()));
+            const auto col { column_of[type_id<T>()] };
+            return std::launder(reinterpret_cast<T*>(c.data + offsets[col]));
+        }
+    };
+
+    // Storage mode of ecs::context where entities are grouped by their set
+    // of components. Components of entities in the same archetype live next
+    // to each other in chunks, so iterating several components at once reads
+    // memory linearly. Adding or removing a component moves the entity to the
+    // archetype matching its new signature.
+    class archetype_storage {
+      private:
+        struct record {
+            archetype* arch {};
+            location   loc {};
+        };
+
+        using archetype_map =
+          std::unordered_map<signature, std::unique_ptr<archetype>>;
+
+        archetype_map                              archetypes {};
+        std::unordered_map<size_t, component_info> infos {};
+        std::vector<record>                        records {};
+
+        record& record_of(entity_id eid);
+
+        archetype& find_or_create(const signature&);
+
+        // Moves eid to the archetype with signature `to`, returns the new
+        // record. Components not in `to` are destroyed.
+        record& move(entity_id eid, const signature& to);
+
+      public:
+        archetype_storage() = default;
+
+        // no copy
+        archetype_storage(const archetype_storage&) = delete;
+        archetype_storage& operator=(const archetype_storage&) = delete;
+
+        // allow move
+        archetype_storage(archetype_storage&&) = default;
+        archetype_storage& operator=(archetype_storage&&) = default;
+
+        // Throws std::logic_error if eid has a T already, like
+        // components<T>::add
+        template<component_type T, typename... Args>
+        T& add(entity_id eid, Args... args) {
+            const auto bit { type_id<T>() };
+
+            const auto& current { record_of(eid) };
+            auto        sig { current.arch ? current.arch->get_signature()
+                                           : signature {} };
+
+            if ( sig.test(bit) ) {
+                throw std::logic_error("Entity already has component");
+            }
+
+            infos.try_emplace(bit, component_info::of<T>());
+
+            auto& rec { move(eid, sig.set(bit)) };
+            return *new (rec.arch->get(bit, rec.loc))
+              T(std::forward<Args>(args)...);
+        }
+
+        template<component_type T>
+        bool has(entity_id eid) {
+            const auto& rec { record_of(eid) };
+            return rec.arch && rec.arch->has(type_id<T>());
+        }
+
+        // Throws std::out_of_range if eid has no T
+        template<component_type T>
+        T& get(entity_id eid) {
+            auto& rec { record_of(eid) };
+
+            if ( !rec.arch || !rec.arch->has(type_id<T>()) ) {
+                throw std::out_of_range("Entity does not have component");
+            }
+
+            return *std::launder(
+              static_cast<T*>(rec.arch->get(type_id<T>(), rec.loc)));
+        }
+
+        template<component_type T>
+        void remove(entity_id eid) {
+            auto& rec { record_of(eid) };
+            if ( !rec.arch || !rec.arch->has(type_id<T>()) ) return;
+
+            move(eid, signature { rec.arch->get_signature() }.reset(
+                        type_id<T>()));
+        }
+
+        // Removes all the components of eid
+        void remove(entity_id eid);
+
+        // Calls fn(entity_id, Ts&...) for every entity that has at least the
+        // components Ts and none of Xs, walking each matching archetype chunk
+        // by chunk
+        template<component_access... Ts, component_type... Xs, typename F>
+        void each(exclude_t<Xs...>, F&& fn) {
+            signature required {};
+            signature excluded {};
+            (required.set(type_id<std::remove_const_t<Ts>>()), ...);
+            (excluded.set(type_id<Xs>()), ...);
+
+            for ( auto& [sig, arch] : archetypes ) {
+                if ( !sig.contains(required) ) continue;
+                if ( sig.intersects(excluded) ) continue;
+
+                for ( auto& c : arch->get_chunks() ) {
+                    auto ids { arch->ids(*c) };
+                    auto columns { std::make_tuple(
+                      arch->template column<std::remove_const_t<Ts>>(*c)...) };
+
+                    for ( uint32_t i = 0; i < c->count; ++i ) {
+                        fn(ids[i],
+                           std::get<std::remove_const_t<Ts>*>(columns)[i]...);
+                    }
+                }
+            }
+        }
+
+        template<component_access... Ts, typename F>
+        void each(F&& fn) {
+            each<Ts...>(exclude_t<> {}, std::forward<F>(fn));
+        }
+    };
+
+}  // namespace ecs
+
+#endif
@@ -0,0 +1,47 @@
+#include "command_buffer.hpp"
+
+#include <vector>
+
+namespace ecs {
+
+    command_buffer::command_buffer(context& c)
+      : ctx { c } {}
+
+    entity_id command_buffer::create() {
+        return ctx.create_concurrent();
+    }
+
+    void command_buffer::destroy(entity_id eid) {
+        lanes.local().destroyed.push_back(eid);
+    }
+
+    void command_buffer::playback() {
+        // gather every lane's commands by type, so each store is visited in
+        // one go, in type_id order
+        std::vector<std::vector<icommands*>> by_type {};
+
+        lanes.for_each([&](lane& l) {
+            if ( l.types.size() > by_type.size() ) {
+                by_type.resize(l.types.size());
+            }
+            for ( size_t id = 0; id < l.types.size(); ++id ) {
+                if ( l.types[id] ) by_type[id].push_back(l.types[id].get());
+            }
+        });
+
+        for ( auto& cmds : by_type ) {
+            for ( auto c : cmds ) {
+                c->play(ctx);
+                c->clear();
+            }
+        }
+
+        lanes.for_each([&](lane& l) {
+            for ( auto eid : l.destroyed ) {
+                ctx.destroy(eid);
+            }
+            l.destroyed.clear();
+        });
+    }
+
+}  // namespace ecs
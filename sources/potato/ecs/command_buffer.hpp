@@ -0,0 +1,143 @@
+#ifndef POTATO_ECS_COMMAND_BUFFER_HPP
+#define POTATO_ECS_COMMAND_BUFFER_HPP
+
+#include "component.hpp"
+#include "context.hpp"
+#include "per_thread.hpp"
+#include "utils.hpp"
+
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace ecs {
+
+    // Records structural changes to a context so they can be applied later,
+    // at a point where nothing is iterating the stores. Any number of threads
+    // may record at once, each into its own lane.
+    //
+    // playback() applies the recorded operations grouped by component type,
+    // so every store is visited once. Within a type, operations keep the
+    // order they were recorded in. Destruction happens last, after all adds
+    // and removes.
+    class command_buffer {
+      private:
+        class icommands {
+          public:
+            virtual ~icommands() = default;
+
+            virtual void play(context&) = 0;
+            virtual void clear()        = 0;
+        };
+
+        template<component_type T>
+        class commands final : public icommands {
+          private:
+            // an empty value means "remove the component"
+            std::vector<std::pair<entity_id, std::optional<T>>> ops {};
+
+          public:
+            template<typename... Args>
+            void add(entity_id eid, Args... args) {
+                ops.emplace_back(
+                  eid, std::optional<T> { std::in_place,
+                                          std::forward<Args>(args)... });
+            }
+
+            void remove(entity_id eid) {
+                ops.emplace_back(eid, std::nullopt);
+            }
+
+            void play(context& ctx) override {
+                if ( ctx.get_storage() == storage::sparse ) {
+                    play_store(ctx, ctx.get_component<T>());
+                    return;
+                }
+
+                for ( auto& [eid, value] : ops ) {
+                    if ( !ctx.alive(eid) ) continue;
+
+                    if ( !value ) {
+                        ctx.remove<T>(eid);
+                    }
+                    else if ( ctx.has<T>(eid) ) {
+                        ctx.get<T>(eid) = std::move(*value);
+                    }
+                    else {
+                        ctx.add<T>(eid, std::move(*value));
+                    }
+                }
+            }
+
+            void play_store(const context& ctx, store_for<T>& store) {
+                for ( auto& [eid, value] : ops ) {
+                    if ( !ctx.alive(eid) ) continue;
+
+                    if ( !value ) {
+                        store.remove(eid);
+                    }
+                    else if ( store.contains(eid) ) {
+                        store.get(eid) = std::move(*value);
+                    }
+                    else {
+                        store.add(eid, std::move(*value));
+                    }
+                }
+            }
+
+            void clear() override {
+                ops.clear();
+            }
+        };
+
+        // everything one thread recorded
+        struct lane {
+            // indexed by type_id
+            std::vector<std::unique_ptr<icommands>> types {};
+            std::vector<entity_id>                  destroyed {};
+
+            template<component_type T>
+            commands<T>& of() {
+                const auto id { type_id<T>() };
+                if ( id >= types.size() ) types.resize(id + 1);
+
+                auto& cmds { types[id] };
+                if ( !cmds ) cmds = std::make_unique<commands<T>>();
+                return static_cast<commands<T>&>(*cmds);
+            }
+        };
+
+        context&         ctx;
+        per_thread<lane> lanes {};
+
+      public:
+        explicit command_buffer(context&);
+
+        // no copy, no move, threads hold on to their lanes
+        command_buffer(const command_buffer&) = delete;
+        command_buffer& operator=(const command_buffer&) = delete;
+
+        // The handle is valid right away, its components arrive on playback
+        entity_id create();
+        void      destroy(entity_id);
+
+        // Adds the component, or overwrites it if the entity already has one
+        template<component_type T, typename... Args>
+        void add(entity_id eid, Args... args) {
+            lanes.local().of<T>().add(eid, std::forward<Args>(args)...);
+        }
+
+        template<component_type T>
+        void remove(entity_id eid) {
+            lanes.local().of<T>().remove(eid);
+        }
+
+        // Applies and clears everything recorded so far. Must run on the
+        // thread that owns the context, while no thread is recording
+        void playback();
+    };
+
+}  // namespace ecs
+
+#endif
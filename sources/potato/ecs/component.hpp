@@ -2,8 +2,24 @@
 #define POTATO_ECS_COMPONENT_HPP
 
 #include "entity.hpp"
+#include "observer.hpp"
+#include "paged_vector.hpp"
+#include "per_thread.hpp"
+#include "snapshot.hpp"
+#include "sparse_set.hpp"
 #include "utils.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <concepts>
+#include <memory>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
 namespace ecs {
 
     class icomponents {
@@ -19,29 +35,128 @@ namespace ecs {
         icomponents(icomponents&&)   = default;
         virtual icomponents& operator=(icomponents&&) = default;
 
-        virtual void remove(const entity&) = 0;
+        virtual void remove(entity::id) = 0;
+
+        // remove() of every id, one virtual call for the whole batch
+        virtual void remove_bulk(std::span<const entity::id>) = 0;
+
+        // Moves components staged by add_concurrent into the store, dropping
+        // those whose entity died or got the component in the meantime
+        virtual void flush(const context&) = 0;
+
+        virtual void clear() = 0;
+
+        // Snapshot support, see ecs::snapshot. Stores are matched by the
+        // type_key() of their component. Stores of components that are not
+        // trivially copyable write nothing and are left empty by load()
+        virtual uint64_t key() const                    = 0;
+        virtual void     save(snapshot_writer&) const   = 0;
+        virtual void     load(const snapshot_section&) = 0;
+
+        // Throws std::runtime_error if load() would reject the section
+        // because of how its columns are laid out. Leaves the store alone
+        virtual void check_layout(const snapshot_section&) const = 0;
+    };
+
+    // Keeps the components of a store in some order of its own, and is
+    // told of every add and remove so it can do so as they happen, see
+    // ecs::group. A store has at most one owner
+    class store_owner {
+      public:
+        // eid's component was appended to the store
+        virtual void added(entity::id eid) = 0;
+
+        // eid's component is about to be removed from the store
+        virtual void removing(entity::id eid) = 0;
+
+      protected:
+        ~store_owner() = default;
     };
 
     template<component_type T>
     class components final : public icomponents {
       public:
-        using type = T;
+        using type  = T;
+        using index = sparse_set::index;
 
       private:
-        using index  = uint32_t;
-        using ec_map = std::unordered_map<entity::id, index>;
-        using ce_map = std::unordered_map<index, entity::id>;
+        // components added through add_concurrent by one thread
+        struct stage {
+            std::vector<entity::id> ids {};
+            std::vector<T>          items {};
+        };
 
-        ec_map         entity_component {};
-        ce_map         component_entity {};
-        std::vector<T> items {};
+        using item_pages =
+          paged_vector<T, page_traits<T>::size, page_traits<T>::huge>;
 
-      public:
-        components() {
-            items.reserve(4096);
+        // `entities`, `items` and `changed` are kept in step, the component
+        // at items[i] belongs to the entity entities.entities()[i] and was
+        // last changed at tick changed[i]. Items are paged, so adding never
+        // moves the components already in the store
+        sparse_set          entities {};
+        item_pages          items {};
+        std::vector<tick_t> changed {};
+
+        // one stage per thread that ever added concurrently. Boxed, threads
+        // hold on to their stage while the store itself may move
+        std::unique_ptr<per_thread<stage>> staged {
+            std::make_unique<per_thread<stage>>()
+        };
+
+        // masks of the owning context, kept in step with `entities` so the
+        // context knows which stores an entity is in. May be null for a
+        // store that lives on its own
+        entity_masks* masks {};
+        size_t        bit { type_id<T>() };
+
+        // change clock of the owning context, null for a store on its own
+        const std::atomic<tick_t>* clock {};
+
+        // bumped whenever components are added, removed or reordered, and
+        // only when they are reordered or cleared
+        uint64_t revision {};
+        uint64_t reorders {};
+
+        store_owner* owner {};
+
+        // observers to record events for, see ecs::observer
+        std::vector<event_sink*> sinks {};
+
+        tick_t now() const {
+            return clock ? clock->load(std::memory_order_relaxed) : 0;
+        }
+
+        void notify(entity::id eid, component_event kind) {
+            for ( auto s : sinks ) {
+                s->record(eid, kind);
+            }
+        }
+
+        // Stamps the component at inx as changed now. Observers hear of it
+        // once per tick, or every time for a store without a clock
+        void stamp(index inx) {
+            const auto t { now() };
+
+            if ( !sinks.empty() && (changed[inx] != t || !clock) ) {
+                for ( auto s : sinks ) {
+                    s->record_change(entities.entities()[inx]);
+                }
+            }
+
+            changed[inx] = t;
         }
 
-        ~components() = default;
+      public:
+        explicit components(entity_masks*              masks = nullptr,
+                            const std::atomic<tick_t>* clock = nullptr)
+          : masks { masks }
+          , clock { clock } {}
+
+        ~components() {
+            for ( auto s : sinks ) {
+                s->source = nullptr;
+            }
+        }
 
         // no copy
         components(const components&) = delete;
@@ -51,50 +166,372 @@ namespace ecs {
         components(components&&) = default;
         components& operator=(components&&) = default;
 
+        // Throws std::logic_error if eid has a T already
         template<typename... Args>
-        T& add(const entity& e, Args... args) {
-            // add to the vector
-            // size - 1 is the index at which our inserted element is stored
+        T& add(entity::id eid, Args... args) {
+            if ( contains(eid) ) {
+                throw std::logic_error("Entity already has component");
+            }
+
+            // the new component goes to the back of `items`, at the same index
+            // the sparse set hands out for the entity
             items.emplace_back(std::forward<Args>(args)...);
-            auto inx = items.size() - 1;
+            entities.insert(eid);
+            changed.push_back(now());
+            if ( masks ) masks->set(eid.index, bit);
+            ++revision;
+            notify(eid, component_event::added);
+
+            // the owner may move it, find it again
+            if ( owner ) {
+                owner->added(eid);
+                return items[entities.index_of(eid)];
+            }
+
+            return items.back();
+        }
 
-            auto eid              = e.get_id();
-            entity_component[eid] = inx;  // entity e is at index
-            component_entity[inx] = eid;  // index contains entity e
+        template<typename... Args>
+        T& add(const entity& e, Args... args) {
+            return add(e.get_id(), std::forward<Args>(args)...);
+        }
+
+        // Adds values[i] for ids[i]. Everything is appended in one go, which
+        // for trivially copyable T comes down to a memmove per page. Throws
+        // std::logic_error and adds nothing if an id has a T already or
+        // shows up twice
+        void add_bulk(std::span<const entity::id> ids,
+                      std::span<const T>          values) {
+            assert(ids.size() == values.size());
+            entities.insert(ids);
+            items.append(values);
+            mark(ids);
+        }
+
+        // Adds make(id) for every id in ids, same rules as above
+        template<std::invocable<entity::id> F>
+        void add_bulk(std::span<const entity::id> ids, F&& make) {
+            entities.insert(ids);
+            items.reserve(items.size() + ids.size());
+            for ( auto eid : ids ) {
+                items.push_back(make(eid));
+            }
+            mark(ids);
+        }
+
+      private:
+        // brings the stamps and masks up to date after a bulk add
+        void mark(std::span<const entity::id> ids) {
+            changed.resize(items.size(), now());
+            ++revision;
+
+            for ( auto eid : ids ) {
+                if ( masks ) masks->set(eid.index, bit);
+                notify(eid, component_event::added);
+                if ( owner ) owner->added(eid);
+            }
+        }
+
+      public:
+        bool contains(entity::id eid) const {
+            return entities.contains(eid);
+        }
+
+        bool contains(const entity& e) const {
+            return contains(e.get_id());
+        }
+
+        // Mutable access counts as a change, the component is stamped with
+        // the current tick. Use get_const() to only read. Throws
+        // std::out_of_range if eid has no T
+        T& get(entity::id eid) {
+            const auto inx { entities.find(eid) };
 
+            if ( inx == sparse_set::npos ) {
+                throw std::out_of_range("Entity does not have component");
+            }
+
+            stamp(inx);
             return items[inx];
         }
 
         T& get(const entity& e) {
-            return items[entity_component[e.get_id()]];
+            return get(e.get_id());
+        }
+
+        const T& get_const(entity::id eid) const {
+            const auto inx { entities.find(eid) };
+
+            if ( inx == sparse_set::npos ) {
+                throw std::out_of_range("Entity does not have component");
+            }
+
+            return items[inx];
+        }
+
+        const T& get_const(const entity& e) const {
+            return get_const(e.get_id());
         }
 
-        const T& get_const(const entity& e) {
-            return items.at(entity_component.at(e.get_id()));
+        // get() by position rather than by entity, see find()
+        T& get_at(index pos) {
+            stamp(pos);
+            return items[pos];
         }
 
-        void remove(const entity& e) override {
-            // To remove an entity's component, update the vector such that the
-            // last entity in the vector is moved to the hole created by the
-            // removed component. While doing so, also update the moved entity's
-            // mappings
-            auto last_cmp   = items.size() - 1;
-            auto last_eid   = component_entity[last_cmp];
-            auto remove_eid = e.get_id();
-            auto new_inx    = entity_component[remove_eid];
+        // Position of eid's component, see operator[], or sparse_set::npos
+        index find(entity::id eid) const {
+            return entities.find(eid);
+        }
+
+        // Tick of the last change to eid's component, 0 if it has none
+        tick_t changed_at(entity::id eid) const {
+            const auto inx { entities.find(eid) };
+            return inx != sparse_set::npos ? changed[inx] : 0;
+        }
+
+        // Marks eid's component as changed without touching it, for writes
+        // that went through page(), operator[] or the iterators
+        void touch(entity::id eid) {
+            stamp(entities.index_of(eid));
+        }
 
-            // move the last entity's component to the hole at index
-            // `entity_component[e]`
-            items[new_inx] = std::move(items[last_cmp]);
+        // Safe from any thread, as long as no flush() runs at the same time.
+        // The component only shows up in the store after flush()
+        template<typename... Args>
+        void add_concurrent(entity::id eid, Args... args) {
+            auto& local { staged->local() };
+            local.ids.push_back(eid);
+            local.items.emplace_back(std::forward<Args>(args)...);
+        }
+
+        void flush(const context& ctx) override {
+            staged->for_each([&](stage& s) {
+                for ( size_t i = 0; i < s.ids.size(); ++i ) {
+                    if ( ctx.alive(s.ids[i]) && !contains(s.ids[i]) ) {
+                        add(s.ids[i], std::move(s.items[i]));
+                    }
+                }
+                s.ids.clear();
+                s.items.clear();
+            });
+        }
+
+        void remove(entity::id eid) override {
+            if ( !contains(eid) ) return;
+            if ( owner ) owner->removing(eid);
+
+            // To remove an entity's component, move the last component in the
+            // vector to the hole created by the removed component. The sparse
+            // set does the same with the ids and hands back the hole's index
+            auto inx { entities.erase(eid) };
+            if ( masks ) masks->reset(eid.index, bit);
+
+            if ( inx != items.size() - 1 ) {
+                items[inx]   = std::move(items.back());
+                changed[inx] = changed.back();
+            }
 
             items.pop_back();
+            changed.pop_back();
+            ++revision;
+            notify(eid, component_event::removed);
+        }
 
-            // Update the entity<->component mapping for the `moved_entity`
-            entity_component[last_eid] = new_inx;
-            component_entity[new_inx]  = last_eid;
+        void remove_bulk(std::span<const entity::id> ids) override {
+            for ( auto eid : ids ) {
+                remove(eid);
+            }
+        }
+
+        // Exchanges the components at positions a and b, with their ids
+        void swap(index a, index b) {
+            if ( a == b ) return;
+
+            using std::swap;
+            swap(items[a], items[b]);
+            swap(changed[a], changed[b]);
+            entities.swap(a, b);
+            ++revision;
+            ++reorders;
+        }
+
+        // Reorders the first perm.size() components, so that position i
+        // ends up with the component that was at perm[i]. perm must be a
+        // permutation of [0, perm.size()) and is overwritten. Every
+        // component is moved at most once, cycle by cycle
+        void permute(std::span<index> perm) {
+            for ( index i = 0; i < perm.size(); ++i ) {
+                auto at { i };
+                while ( perm[at] != i ) {
+                    const auto next { perm[at] };
+                    swap(at, next);
+                    perm[at] = at;
+                    at       = next;
+                }
+                perm[at] = at;
+            }
+        }
+
+        // Sorts the store by comp(const T&, const T&), so iterating it
+        // visits components in that order. Like removing, sorting moves
+        // components, references to them do not follow
+        template<typename Compare>
+        void sort(Compare comp) {
+            std::vector<index> perm(size());
+            std::iota(perm.begin(), perm.end(), index { 0 });
+            std::sort(perm.begin(), perm.end(), [&](index a, index b) {
+                return comp(std::as_const(items[a]), std::as_const(items[b]));
+            });
+            permute(perm);
+        }
+
+        // Changes every time components are added, removed or reordered,
+        // which tells whoever keeps positions in the store when to look
+        // them up again
+        uint64_t layout_revision() const {
+            return revision;
+        }
+
+        // Changes when components are reordered by swap(), permute() or
+        // sort(), or the store is cleared, the changes an owner is not told
+        // of one by one
+        uint64_t order_revision() const {
+            return reorders;
+        }
+
+        // Tells `o` of every add and remove from now on, null to stop
+        void set_owner(store_owner* o) {
+            owner = o;
+        }
+
+        void reserve(size_t n) {
+            entities.reserve(n);
+            items.reserve(n);
+            changed.reserve(n);
+        }
+
+        void clear() override {
+            for ( auto eid : ids() ) {
+                if ( masks ) masks->reset(eid.index, bit);
+                notify(eid, component_event::removed);
+            }
+
+            entities.clear();
+            items.clear();
+            changed.clear();
+            ++revision;
+            ++reorders;
+        }
+
+        // Starts recording events into sink, see ecs::observer
+        void subscribe(event_sink& sink) {
+            sink.source = this;
+            sinks.push_back(&sink);
+        }
+
+        void unsubscribe(event_sink& sink) {
+            std::erase(sinks, &sink);
+            sink.source = nullptr;
+        }
+
+        uint64_t key() const override {
+            return type_key<T>();
+        }
+
+        void save(snapshot_writer& out) const override {
+            if constexpr ( std::is_trivially_copyable_v<T> ) {
+                out.store(key(), ids(), 1);
+                out.column(sizeof(T), alignof(T));
+
+                for ( size_t p = 0; p < items.page_count(); ++p ) {
+                    out.append(std::as_bytes(items.page(p)));
+                }
+            }
+        }
+
+        // A single column of T
+        void check_layout(const snapshot_section& in) const override {
+            if constexpr ( std::is_trivially_copyable_v<T> ) {
+                in.expect_columns(1);
+                in.expect_column<T>(0);
+            }
+        }
+
+        // Replaces the contents of the store with the saved components, in
+        // one copy per array. Everything loaded counts as changed now
+        void load(const snapshot_section& in) override {
+            clear();
+
+            if constexpr ( std::is_trivially_copyable_v<T> ) {
+                items.assign(in.column<T>(0));
+                entities.insert(in.ids);
+                mark(in.ids);
+            }
+        }
+
+        size_t size() const {
+            return items.size();
+        }
+
+        bool empty() const {
+            return items.empty();
+        }
+
+        // Packed views of the store, ids()[i] owns (*this)[i]. Components are
+        // contiguous a page at a time, page(p) holds components
+        // [p * page_size, p * page_size + page(p).size()). Writes through
+        // pages, operator[] or the iterators are not tracked, see touch()
+        std::span<const entity::id> ids() const {
+            return entities.entities();
+        }
+
+        static constexpr size_t page_size = item_pages::page_size;
+
+        size_t page_count() const {
+            return items.page_count();
+        }
+
+        std::span<T> page(size_t p) {
+            return items.page(p);
+        }
+
+        std::span<const T> page(size_t p) const {
+            return items.page(p);
+        }
+
+        T& operator[](size_t i) {
+            return items[i];
+        }
+
+        const T& operator[](size_t i) const {
+            return items[i];
+        }
+
+        // Frees pages left empty by removals
+        void shrink_to_fit() {
+            items.shrink_to_fit();
+        }
+
+        // changes()[i] is the tick (*this)[i] last changed at
+        std::span<const tick_t> changes() const {
+            return changed;
+        }
+
+        auto begin() {
+            return items.begin();
+        }
+
+        auto end() {
+            return items.end();
+        }
+
+        auto begin() const {
+            return items.cbegin();
+        }
 
-            entity_component.erase(remove_eid);
-            component_entity.erase(last_cmp);
+        auto end() const {
+            return items.cend();
         }
     };
 
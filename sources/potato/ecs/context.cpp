@@ -2,15 +2,182 @@
 
 #include "component.hpp"
 #include "entity.hpp"
+#include "group.hpp"
+#include "snapshot.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    // Every id of a section must be alive in the saved generations, and
+    // in it once, or the store would end up with entries for handles that
+    // do not exist
+    void check_ids(std::span<const ecs::entity_id> ids,
+                   std::span<const uint32_t>       gens) {
+        std::vector<bool> seen(gens.size());
+
+        for ( auto eid : ids ) {
+            if ( !ecs::handle_allocator::alive_in(gens, eid) ) {
+                throw std::runtime_error("Snapshot names a dead entity");
+            }
+            if ( seen[eid.index] ) {
+                throw std::runtime_error("Snapshot names an entity twice");
+            }
+            seen[eid.index] = true;
+        }
+    }
+}  // namespace
 
 namespace ecs {
+    context::context(storage mode)
+      : mode { mode } {}
+
+    // out of line, so that the stores and groups need not be complete
+    // wherever a context is destroyed or moved
+    context::~context() = default;
+
+    context::context(context&&)            = default;
+    context& context::operator=(context&&) = default;
+
     entity context::create_entity() {
         return entity { *this };
     }
 
     void context::remove_entity(const entity& e) {
-        for ( auto& i : component_arrays ) {
-            i.second->remove(e);
+        destroy(e.get_id());
+    }
+
+    entity_id context::create() {
+        return handles->create();
+    }
+
+    std::vector<entity_id> context::create_entities(size_t n) {
+        std::vector<entity_id> ids(n);
+        handles->create(ids);
+        return ids;
+    }
+
+    void context::destroy_bulk(std::span<const entity_id> ids) {
+        if ( mode == storage::archetype ) {
+            for ( auto eid : ids ) {
+                if ( alive(eid) ) archetypes.remove(eid);
+            }
+        }
+        else {
+            // the ids to take out of each store, so that every store is
+            // gone through once for the whole batch
+            std::vector<std::vector<entity_id>> doomed(component_arrays.size());
+
+            for ( auto eid : ids ) {
+                if ( !alive(eid) ) continue;
+
+                masks->for_each(eid.index, [&](size_t bit) {
+                    doomed[bit].push_back(eid);
+                });
+            }
+
+            for ( size_t bit = 0; bit < doomed.size(); ++bit ) {
+                if ( !doomed[bit].empty() ) {
+                    component_arrays[bit]->remove_bulk(doomed[bit]);
+                }
+            }
+        }
+
+        handles->release(ids);
+    }
+
+    void context::remove_components(entity_id eid) {
+        // only the stores the entity is actually in, each of them clears
+        // its bit as it goes
+        masks->for_each(eid.index, [&](size_t bit) {
+            component_arrays[bit]->remove(eid);
+        });
+    }
+
+    igroup* context::find_group(const signature& types,
+                                const void*      tag) const {
+        for ( const auto& g : groups ) {
+            if ( g->owned() == types && g->tag() == tag ) {
+                return g.get();
+            }
+            if ( g->owned().intersects(types) ) {
+                throw std::logic_error(
+                  "Component is already owned by another group");
+            }
+        }
+
+        return nullptr;
+    }
+
+    entity_id context::create_concurrent() {
+        return handles->create_concurrent();
+    }
+
+    void context::destroy(entity_id eid) {
+        if ( !alive(eid) ) return;
+
+        if ( mode == storage::archetype ) {
+            archetypes.remove(eid);
+        }
+        else {
+            remove_components(eid);
+        }
+
+        handles->release(eid);
+    }
+
+    void context::save(const std::string& fname) const {
+        require_sparse("Snapshots need sparse component storage");
+
+        snapshot_writer out { fname, handles->generations() };
+        for ( const auto& store : component_arrays ) {
+            if ( store ) store->save(out);
+        }
+        out.finish();
+    }
+
+    void context::load(const snapshot& snap) {
+        require_sparse("Snapshots need sparse component storage");
+
+        // checked up front, a snapshot that is rejected leaves the context
+        // as it was
+        if ( snap.generations().size() > handle_allocator::max_entities ) {
+            throw std::length_error("Out of entity indices");
+        }
+
+        for ( auto& store : component_arrays ) {
+            if ( !store ) continue;
+
+            if ( auto section { snap.find(store->key()) } ) {
+                store->check_layout(*section);
+                check_ids(section->ids, snap.generations());
+            }
+        }
+
+        for ( auto& store : component_arrays ) {
+            if ( store ) store->clear();
+        }
+
+        handles->restore(snap.generations());
+
+        for ( auto& store : component_arrays ) {
+            if ( !store ) continue;
+
+            if ( auto section { snap.find(store->key()) } ) {
+                store->load(*section);
+            }
+        }
+    }
+
+    void context::load(const std::string& fname) {
+        load(snapshot { fname });
+    }
+
+    void context::flush() {
+        handles->reclaim();
+
+        for ( auto& store : component_arrays ) {
+            if ( store ) store->flush(*this);
         }
     }
 }  // namespace ecs
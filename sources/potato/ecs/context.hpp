@@ -1,10 +1,17 @@
 #ifndef POTATO_ECS_CONTEXT_HPP
 #define POTATO_ECS_CONTEXT_HPP
 
+#include "archetype.hpp"
+#include "handles.hpp"
 #include "utils.hpp"
 
+#include <atomic>
+#include <cassert>
 #include <memory>
-#include <unordered_map>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <tuple>
 #include <vector>
 
 namespace {
@@ -13,48 +20,391 @@ namespace {
 
 namespace ecs {
 
+    // How a context lays out the components of its entities
+    enum class storage {
+        // one sparse-set store per component type, see ecs::components
+        sparse,
+        // entities grouped by component set, see ecs::archetype_storage
+        archetype,
+    };
+
     class context {
       private:
+        storage mode { storage::sparse };
+
         // context stores all the component arrays that this context is
-        // responsible for
-        std::unordered_map<uint64_t, std::unique_ptr<icomponents>>
-          component_arrays {};
+        // responsible for, indexed by type_id. Slots of types never added
+        // to this context are null
+        std::vector<std::unique_ptr<icomponents>> component_arrays {};
+
+        // which stores each entity is in, kept up to date by the stores
+        // themselves. Boxed so its address survives moving the context
+        std::unique_ptr<entity_masks> masks {
+            std::make_unique<entity_masks>()
+        };
+
+        // change clock read by the stores, boxed for the same reason
+        std::unique_ptr<std::atomic<tick_t>> clock {
+            std::make_unique<std::atomic<tick_t>>(1)
+        };
+
+        // destroys a resource through the type it was created with
+        struct resource_deleter {
+            void (*destroy)(void*) {};
+
+            void operator()(void* p) const {
+                destroy(p);
+            }
+        };
+
+        using resource_ptr = std::unique_ptr<void, resource_deleter>;
+
+        // singletons of the whole world, indexed by type_id. Slots of types
+        // that were never set are null
+        std::vector<resource_ptr> resources {};
+
+        // owning groups handed out by group(), no two share a type
+        std::vector<std::unique_ptr<igroup>> groups {};
+
+        // used instead of component_arrays in storage::archetype mode
+        archetype_storage archetypes {};
+
+        // boxed like masks, threads creating entities hold on to it
+        std::unique_ptr<handle_allocator> handles {
+            std::make_unique<handle_allocator>()
+        };
+
+        // removes eid from every store its mask says it is in
+        void remove_components(entity_id eid);
+
+        // the group owning exactly `types`, null if there is none yet.
+        // Throws if another group owns any of them
+        igroup* find_group(const signature& types, const void* tag) const;
+
+        // for what only exists in storage::sparse mode
+        void require_sparse(const char* what) const {
+            if ( mode != storage::sparse ) {
+                throw std::logic_error(what);
+            }
+        }
+
+        static constexpr auto soa_needs_sparse {
+            "Structure-of-arrays components need sparse storage"
+        };
 
       public:
-        context()  = default;
-        ~context() = default;
+        explicit context(storage mode = storage::sparse);
+        ~context();
 
         // no copy
         context(const context&) = delete;
         context& operator=(const context&) = delete;
 
         // allow move
-        context(context&&) = default;
-        context& operator=(context&&) = default;
+        context(context&&);
+        context& operator=(context&&);
 
         template<component_type T>
         context& add_component() {
-            if ( component_arrays.contains(T::signature) ) {
+            const auto id { type_id<T>() };
+
+            if ( id >= component_arrays.size() ) {
+                component_arrays.resize(id + 1);
+                masks->fit(id + 1);
+            }
+
+            if ( component_arrays[id] ) {
                 throw std::runtime_error("Context cannot contain more than one "
                                          "component store of same type");
             }
-            component_arrays[T::signature] = std::make_unique<components<T>>();
+            component_arrays[id] =
+              std::make_unique<store_for<T>>(masks.get(), clock.get());
             return *this;
         }
 
+        // Store of T, or nullptr if T was never added to the context
+        template<component_type T>
+        store_for<T>* find_component() {
+            const auto id { type_id<T>() };
+            return id < component_arrays.size()
+                   ? static_cast<store_for<T>*>(component_arrays[id].get())
+                   : nullptr;
+        }
+
+        template<component_type T>
+        const store_for<T>* find_component() const {
+            return const_cast<context*>(this)->find_component<T>();
+        }
+
+        template<component_type T>
+        store_for<T>& get_component() {
+            auto store { find_component<T>() };
+            if ( !store ) {
+                throw std::out_of_range("Component store not in context");
+            }
+            return *store;
+        }
+
+        template<component_type T>
+        const store_for<T>& get_component() const {
+            return const_cast<context*>(this)->get_component<T>();
+        }
+
+        // Stores `T { args... }` as the context's one T, replacing the one
+        // set before, and returns it. Resources hold what the whole world
+        // shares, like the camera or the frame time, once rather than as a
+        // component of some entity. They work in either storage mode, and
+        // are neither saved to snapshots nor touched by load()
+        template<component_type T, typename... Args>
+        T& set_resource(Args&&... args) {
+            const auto id { type_id<T>() };
+            if ( id >= resources.size() ) resources.resize(id + 1);
+
+            auto created { new T { std::forward<Args>(args)... } };
+            resources[id] = resource_ptr {
+                created,
+                { [](void* p) { delete static_cast<T*>(p); } }
+            };
+            return *created;
+        }
+
+        // The context's T, or nullptr if none was set
         template<component_type T>
-        components<T>& get_component() {
-            auto&& a = component_arrays.at(T::signature).get();
-            return *reinterpret_cast<components<T>*>(a);
+        T* find_resource() {
+            const auto id { type_id<T>() };
+            return id < resources.size()
+                   ? static_cast<T*>(resources[id].get())
+                   : nullptr;
         }
 
         template<component_type T>
-        components<T>& get_component() const {
-            return component_arrays[T::signature];
+        const T* find_resource() const {
+            return const_cast<context*>(this)->find_resource<T>();
         }
 
+        template<component_type T>
+        T& resource() {
+            auto res { find_resource<T>() };
+            if ( !res ) {
+                throw std::out_of_range("Resource not in context");
+            }
+            return *res;
+        }
+
+        template<component_type T>
+        const T& resource() const {
+            return const_cast<context*>(this)->resource<T>();
+        }
+
+        template<component_type T>
+        void remove_resource() {
+            const auto id { type_id<T>() };
+            if ( id < resources.size() ) resources[id].reset();
+        }
+
+        archetype_storage& get_archetypes() {
+            return archetypes;
+        }
+
+        storage get_storage() const {
+            return mode;
+        }
+
+        // Component access by entity id that works in either storage mode.
+        // Returns a T&, or the store's proxy for structure-of-arrays
+        // components, which only live in storage::sparse mode
+        template<component_type T, typename... Args>
+        decltype(auto) add(entity_id eid, Args... args) {
+            assert(alive(eid));
+            if constexpr ( soa_component<T> ) {
+                require_sparse(soa_needs_sparse);
+            }
+            else if ( mode == storage::archetype ) {
+                return archetypes.add<T>(eid, std::forward<Args>(args)...);
+            }
+            return get_component<T>().add(eid, std::forward<Args>(args)...);
+        }
+
+        template<component_type T>
+        decltype(auto) get(entity_id eid) {
+            if constexpr ( soa_component<T> ) {
+                require_sparse(soa_needs_sparse);
+            }
+            else if ( mode == storage::archetype ) {
+                return archetypes.get<T>(eid);
+            }
+            return get_component<T>().get(eid);
+        }
+
+        template<component_type T>
+        bool has(entity_id eid) {
+            if ( !soa_component<T> && mode == storage::archetype ) {
+                return archetypes.has<T>(eid);
+            }
+            auto store { find_component<T>() };
+            return store && store->contains(eid);
+        }
+
+        template<component_type T>
+        void remove(entity_id eid) {
+            if constexpr ( soa_component<T> ) {
+                require_sparse(soa_needs_sparse);
+                get_component<T>().remove(eid);
+            }
+            else if ( mode == storage::archetype ) {
+                archetypes.remove<T>(eid);
+            }
+            else {
+                get_component<T>().remove(eid);
+            }
+        }
+
+        // Range over the entities that have all of Ts and none of Xs, see
+        // ecs::basic_view. Only available in storage::sparse mode
+        template<component_access... Ts, component_type... Xs>
+        basic_view<exclude_t<Xs...>, Ts...> view(exclude_t<Xs...> = {}) {
+            if ( mode != storage::sparse ) {
+                throw std::logic_error("Views need sparse component storage");
+            }
+            return {
+                std::make_tuple(find_component<std::remove_const_t<Ts>>()...),
+                std::make_tuple(find_component<Xs>()...)
+            };
+        }
+
+        // The group that packs the entities having all of Ts, see
+        // ecs::group. Created on first use, later calls with the same types
+        // in the same order return the same group. Throws std::logic_error
+        // if one of Ts is owned by another group. Only available in
+        // storage::sparse mode
+        template<component_type... Ts>
+        ecs::group<Ts...>& group() {
+            require_sparse("Groups need sparse component storage");
+
+            signature sig {};
+            (sig.set(type_id<Ts>()), ...);
+
+            using group_t = ecs::group<Ts...>;
+
+            if ( auto g { find_group(sig, group_t::static_tag()) } ) {
+                return static_cast<group_t&>(*g);
+            }
+
+            auto& added { groups.emplace_back(
+              std::make_unique<group_t>(get_component<Ts>()...)) };
+            return static_cast<group_t&>(*added);
+        }
+
+        // Calls fn(entity_id, Ts&...) for every entity that has all of Ts and
+        // none of Xs, in either storage mode. Changes are only tracked in
+        // storage::sparse mode, which is also the only mode structure-of-arrays
+        // components work in
+        template<component_access... Ts, component_type... Xs, typename F>
+        void each(exclude_t<Xs...> exc, F&& fn) {
+            if constexpr ( (soa_component<std::remove_const_t<Ts>> || ...) ) {
+                view<Ts...>(exc).each(std::forward<F>(fn));
+            }
+            else if ( mode == storage::archetype ) {
+                archetypes.each<Ts...>(exc, std::forward<F>(fn));
+            }
+            else {
+                view<Ts...>(exc).each(std::forward<F>(fn));
+            }
+        }
+
+        template<component_access... Ts, typename F>
+        void each(F&& fn) {
+            each<Ts...>(exclude_t<> {}, std::forward<F>(fn));
+        }
+
+        // Entity that removes itself from the context when it goes away
         entity create_entity();
         void   remove_entity(const entity&);
+
+        // Bare handles, the caller is responsible for destroying them
+        entity_id create();
+        void      destroy(entity_id);
+
+        // n bare handles at once, much cheaper than n calls to create()
+        std::vector<entity_id> create_entities(size_t n);
+
+        // Destroys every id in ids that is alive. Like destroy(), each
+        // entity only costs as much as the components it owns, but every
+        // store is handed its share of the batch at once and the handles
+        // are released together
+        void destroy_bulk(std::span<const entity_id> ids);
+
+        // Safe to call from any thread, also while the owning thread creates
+        // entities. The handle can be used right away with add_concurrent()
+        entity_id create_concurrent();
+
+        // Stages a component from any thread, it lands in its store at the
+        // next flush(). Only available in storage::sparse mode
+        template<component_type T, typename... Args>
+        void add_concurrent(entity_id eid, Args... args) {
+            if ( mode != storage::sparse ) {
+                throw std::logic_error(
+                  "Concurrent inserts need sparse component storage");
+            }
+            get_component<T>().add_concurrent(eid,
+                                              std::forward<Args>(args)...);
+        }
+
+        // Sync point, moves every staged component into its store and takes
+        // back the indices left in the threads' create_concurrent() blocks.
+        // No other thread may be creating entities or adding components
+        // while this runs
+        void flush();
+
+        // Current value of the change clock. Stores stamp components with
+        // it whenever they are added or accessed mutably
+        tick_t tick() const {
+            return clock->load(std::memory_order_relaxed);
+        }
+
+        // Moves the clock forward and returns the tick it had. Every change
+        // made after this call gets a later stamp, so a system that keeps
+        // the returned value and passes it to changed_since() on its next
+        // run sees exactly what changed in between, its own writes included:
+        //
+        //   auto since { std::exchange(last_seen, ctx.advance_tick()) };
+        //   for ( auto [eid, t] : ctx.view<const transform>()
+        //                           .changed_since(since) ) { ... }
+        tick_t advance_tick() {
+            return clock->fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // true if eid was created by this context and not destroyed since.
+        // Safe from any thread
+        bool alive(entity_id eid) const {
+            return handles->alive(eid);
+        }
+
+        // number of live entities
+        size_t size() const {
+            return handles->size();
+        }
+
+        // Writes every entity handle and every store of trivially copyable
+        // components to a snapshot file, as raw arrays. Only available in
+        // storage::sparse mode
+        void save(const std::string& fname) const;
+
+        // Replaces all entities and components with those of `snap`. Each
+        // registered store takes the section with its type_key() in one
+        // copy per array, sections of types this context never registered
+        // are skipped. Components that are not trivially copyable are not
+        // part of snapshots and are dropped. Handles saved with the snapshot
+        // are alive again, everything loaded counts as changed now. Throws
+        // std::runtime_error, leaving the context untouched, if a section
+        // names an entity that is not alive in the snapshot, or one twice,
+        // or if its columns are not laid out the way the registered store
+        // of its type saves them, as after a component changed under the
+        // same type name
+        void load(const snapshot& snap);
+
+        // Maps the snapshot at `fname` and loads it
+        void load(const std::string& fname);
     };
 
 }  // namespace ecs
@@ -0,0 +1,65 @@
+#include "culling.hpp"
+
+#include "component.hpp"
+#include "spatial.hpp"
+#include "transform.hpp"
+
+#include <algorithm>
+
+namespace ecs {
+
+    culling_system::culling_system(potato::jobs::pool& p)
+      : workers { p } {}
+
+    void culling_system::run(context& ctx, const potato::math::frustum& view) {
+        visible_ids.clear();
+
+        auto world { ctx.find_component<world_transform>() };
+        auto shapes { ctx.find_component<bounds>() };
+
+        if ( !world || !shapes ) return;
+
+        candidates.clear();
+        for ( auto eid : shapes->ids() ) {
+            if ( world->contains(eid) ) candidates.push_back(eid);
+        }
+
+        const auto n { candidates.size() };
+        const auto chunks { (n + chunk_size - 1) / chunk_size };
+
+        spheres.resize(n);
+        hits.resize(n);
+        counts.assign(chunks, 0);
+
+        potato::jobs::parallel_for(
+          0,
+          chunks,
+          [&](size_t c) {
+              const auto first { c * chunk_size };
+              const auto count { std::min(chunk_size, n - first) };
+
+              for ( auto i { first }; i < first + count; ++i ) {
+                  const auto eid { candidates[i] };
+                  spheres.set(i,
+                              shapes->get_const(eid)
+                                .local.bounding_sphere()
+                                .transformed(world->get_const(eid).matrix));
+              }
+
+              counts[c] = potato::math::cull_spheres(
+                view,
+                spheres.view().subview(first, count),
+                std::span { hits }.subspan(first, count));
+          },
+          1,
+          workers);
+
+        for ( size_t c = 0; c < chunks; ++c ) {
+            const auto first { c * chunk_size };
+            for ( size_t k = 0; k < counts[c]; ++k ) {
+                visible_ids.push_back(candidates[first + hits[first + k]]);
+            }
+        }
+    }
+
+}  // namespace ecs
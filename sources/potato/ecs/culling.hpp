@@ -0,0 +1,60 @@
+#ifndef POTATO_ECS_CULLING_HPP
+#define POTATO_ECS_CULLING_HPP
+
+#include "context.hpp"
+#include "core/culling.hpp"
+#include "core/geometry.hpp"
+#include "core/jobs.hpp"
+#include "utils.hpp"
+
+#include <span>
+#include <vector>
+
+namespace ecs {
+
+    // Finds the entities whose bounds, placed by their world_transform,
+    // overlap a frustum.
+    //
+    // Every run gathers the bounding sphere of each entity into structure
+    // of arrays batches and tests them with potato::math::cull_spheres, each
+    // chunk of chunk_size entities as a separate job. The chunks' results
+    // are then compacted into one list, in the order of the bounds store.
+    // Spheres are looser than the boxes, what they let through in excess is
+    // left to the GPU
+    class culling_system {
+      private:
+        std::vector<entity_id>      candidates {};
+        potato::math::sphere_buffer spheres {};
+
+        // chunk c writes its hits from position c * chunk_size on
+        std::vector<uint32_t> hits {};
+        std::vector<size_t>   counts {};
+
+        std::vector<entity_id> visible_ids {};
+
+        potato::jobs::pool& workers;
+
+      public:
+        static constexpr size_t chunk_size = 4096;
+
+        explicit culling_system(potato::jobs::pool& =
+                                  potato::jobs::pool::shared());
+
+        // no copy, no move, running jobs hold on to it
+        culling_system(const culling_system&) = delete;
+        culling_system& operator=(const culling_system&) = delete;
+
+        // Culls every entity that has both a bounds and a world_transform
+        // against `view`. Must not run at the same time as anything that
+        // writes those, run it after the transform_system
+        void run(context&, const potato::math::frustum& view);
+
+        // what passed the last run
+        std::span<const entity_id> visible() const {
+            return visible_ids;
+        }
+    };
+
+}  // namespace ecs
+
+#endif
@@ -1,28 +1,20 @@
 #ifndef POTATO_CORE_ECS_HPP
 #define POTATO_CORE_ECS_HPP
 
+#include "command_buffer.hpp"
 #include "component.hpp"
 #include "context.hpp"
-#include "core/utils.hpp"
+#include "culling.hpp"
 #include "entity.hpp"
+#include "group.hpp"
+#include "observer.hpp"
+#include "scheduler.hpp"
+#include "snapshot.hpp"
+#include "soa.hpp"
+#include "spatial.hpp"
+#include "tag.hpp"
+#include "transform.hpp"
 #include "utils.hpp"
-
-struct transform {
-    static constexpr auto signature = 1 << 1;
-
-    glm::vec3 translation {};
-    glm::vec3 scale { 1.0f };
-    glm::quat rotation {};
-
-    void euler_rotate(glm::vec3 euler_angles) {
-        rotation = glm::toQuat(
-          glm::yawPitchRoll(euler_angles.y, euler_angles.x, euler_angles.z));
-    }
-
-    glm::mat4 mat4() const {
-        return glm::translate(glm::mat4 { 1.f }, translation)
-             * glm::toMat4(rotation) * glm::scale(glm::mat4 { 1.0f }, scale);
-    }
-};
+#include "view.hpp"
 
 #endif
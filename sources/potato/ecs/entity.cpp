@@ -2,23 +2,16 @@
 
 namespace ecs {
 
-    entity::id entity::next_eid = { 1 };
-    entity::id entity::count    = { 0 };
-    // std::mutex   entity::mut   = {};
-
     entity::entity(context& c)
-      : entity_id { next_eid++ }
-      , entity_context { &c } {
-        ++count;
-    }
+      : entity_id { c.create() }
+      , entity_context { &c } {}
 
     entity::id entity::get_id() const {
         return entity_id;
     }
 
     entity::~entity() {
-        if ( entity_id != 0 ) {
-            --count;
+        if ( entity_id ) {
             entity_context->remove_entity(*this);
         }
         // else entity was moved, deleting this is not needed
@@ -26,17 +19,24 @@ namespace ecs {
 
     // // allow move
     entity::entity(entity&& other) {
-        // when moving entity, do a normal move, but make entity_id 0
+        // when moving entity, do a normal move, but null the moved-from id
         entity_id       = other.entity_id;
         entity_context  = other.entity_context;
-        other.entity_id = 0;
+        other.entity_id = {};
     }
 
     entity& entity::operator=(entity&& other) {
-        // when moving entity, do a normal move, but make entity_id 0
+        if ( this == &other ) return *this;
+
+        // the entity this one held is being replaced, let it go first
+        if ( entity_id ) {
+            entity_context->remove_entity(*this);
+        }
+
+        // when moving entity, do a normal move, but null the moved-from id
         entity_id       = other.entity_id;
         entity_context  = other.entity_context;
-        other.entity_id = 0;
+        other.entity_id = {};
         return *this;
     }
 
@@ -4,23 +4,20 @@
 #include "context.hpp"
 #include "utils.hpp"
 
-#include <bitset>
 #include <cstddef>
 
 namespace ecs {
-    // TODO: Thread safety
 
+    // Owning wrapper around an entity handle, destroys the entity when it
+    // goes out of scope. Not thread safe, other threads should go through
+    // context::create_concurrent and context::add_concurrent
     class entity {
       public:
-        using id = uint32_t;
+        using id = ecs::entity_id;
 
       private:
-        static id next_eid;
-        static id count;
-
-        id              entity_id { 0 };
-        context*        entity_context;
-        std::bitset<64> components;
+        id       entity_id {};
+        context* entity_context;
 
       public:
         explicit entity(context& c);
@@ -37,29 +34,34 @@ namespace ecs {
         entity& operator=(entity&&);
 
         template<component_type T, typename... Args>
-        T& add_component(Args... args) {
-            entity_context->get_component<T>().add(*this,
-                                                   std::forward<Args>(args)...);
-            return get_component<T>();
+        decltype(auto) add_component(Args... args) {
+            return entity_context->add<T>(entity_id,
+                                          std::forward<Args>(args)...);
         }
 
         template<typename T>
-        requires component_type<T> T& get_component() {
-            return entity_context->get_component<T>().get(*this);
+        requires component_type<T> decltype(auto) get_component() {
+            return entity_context->get<T>(entity_id);
         }
 
         template<typename T>
-        requires component_type<T> T& get_component() const {
-            return entity_context->get_component<T>().get(*this);
+        requires component_type<T> decltype(auto) get_component() const {
+            return entity_context->get<T>(entity_id);
         }
 
-        // template<typename T>
-        // requires component_type<T>
-        // const T& get_component() const;
+        template<component_type T>
+        bool has() const {
+            return entity_context->has<T>(entity_id);
+        }
+
+        template<component_type T>
+        void remove_component() {
+            entity_context->remove<T>(entity_id);
+        }
 
         // template<typename T>
         // requires component_type<T>
-        // void remove_component();
+        // const T& get_component() const;
     };
 
 }  // namespace ecs
@@ -0,0 +1,205 @@
+#ifndef POTATO_ECS_GROUP_HPP
+#define POTATO_ECS_GROUP_HPP
+
+#include "component.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <span>
+#include <tuple>
+#include <vector>
+
+namespace ecs {
+
+    class igroup {
+      public:
+        igroup()          = default;
+        virtual ~igroup() = default;
+
+        // no copy, no move, handed out by reference
+        igroup(const igroup&) = delete;
+        igroup& operator=(const igroup&) = delete;
+
+        // tells apart groups of the same types listed in another order
+        virtual const void* tag() const = 0;
+
+        // the types the group owns
+        virtual const signature& owned() const = 0;
+    };
+
+    // Keeps the entities that have all of Ts packed at the front of each of
+    // their stores, in the same order. For i < size(), position i of every
+    // store holds the components of the same entity, so iterating a group
+    // walks all of its stores linearly, without a single lookup.
+    //
+    // Adding or removing a component of Ts keeps the stores packed as it
+    // happens, with one swap per store. Only reordering a store directly or
+    // clearing it makes the group pack everything again, in O(size of the
+    // first store), on its next access. Packing keeps the order of the
+    // first store, so sorting it, or calling sort() here, orders the group,
+    // until the next removal moves the last entity of the group into the
+    // hole.
+    // A store can only be owned by one group, tag components have nothing
+    // to pack and cannot be owned at all. Get groups from context::group
+    template<component_type... Ts>
+    requires(sizeof...(Ts) >= 2
+             && (!soa_component<Ts> && ...) && (!tag_component<Ts> && ...))
+    class group final
+      : public igroup
+      , private store_owner {
+      private:
+        using index = sparse_set::index;
+
+        std::tuple<components<Ts>*...>     stores {};
+        std::array<uint64_t, sizeof...(Ts)> seen {};
+        signature                           types {};
+        index                               packed {};
+
+        components<std::tuple_element_t<0, std::tuple<Ts...>>>& lead() {
+            return *std::get<0>(stores);
+        }
+
+        bool stale() const {
+            size_t i { 0 };
+            return ((std::get<components<Ts>*>(stores)->order_revision()
+                     != seen[i++])
+                    || ...);
+        }
+
+        void remember() {
+            size_t i { 0 };
+            ((seen[i++] = std::get<components<Ts>*>(stores)->order_revision()),
+             ...);
+        }
+
+        // moves eid to position `to` of every store
+        void move_to(entity_id eid, index to) {
+            (std::get<components<Ts>*>(stores)->swap(
+               std::get<components<Ts>*>(stores)->find(eid), to),
+             ...);
+        }
+
+        // A stale group packs everything on its next access anyway
+        void added(entity_id eid) override {
+            if ( stale() ) return;
+
+            const bool all {
+                (std::get<components<Ts>*>(stores)->contains(eid) && ...)
+            };
+            if ( !all || lead().find(eid) < packed ) return;
+
+            move_to(eid, packed++);
+            remember();
+        }
+
+        // the last packed entity fills the hole, eid leaves from the end
+        void removing(entity_id eid) override {
+            if ( stale() ) return;
+            if ( lead().find(eid) >= packed ) return;
+
+            move_to(eid, --packed);
+            remember();
+        }
+
+        // moves every entity that has all of Ts to the front of each store,
+        // in the order of the first store
+        void pack() {
+            packed = 0;
+
+            auto& first { lead() };
+            for ( index pos = 0; pos < first.size(); ++pos ) {
+                const auto eid { first.ids()[pos] };
+
+                const bool all {
+                    (std::get<components<Ts>*>(stores)->contains(eid) && ...)
+                };
+                if ( !all ) continue;
+
+                move_to(eid, packed++);
+            }
+
+            remember();
+        }
+
+      public:
+        explicit group(components<Ts>&... s)
+          : stores { &s... } {
+            (types.set(type_id<Ts>()), ...);
+            (s.set_owner(this), ...);
+            pack();
+        }
+
+        ~group() {
+            (std::get<components<Ts>*>(stores)->set_owner(nullptr), ...);
+        }
+
+        // same for every group of Ts, in this order
+        static const void* static_tag() {
+            static constexpr char type_tag {};
+            return &type_tag;
+        }
+
+        const void* tag() const override {
+            return static_tag();
+        }
+
+        const signature& owned() const override {
+            return types;
+        }
+
+        // Packs the stores if they were reordered since the last access
+        void refresh() {
+            if ( stale() ) pack();
+        }
+
+        size_t size() {
+            refresh();
+            return packed;
+        }
+
+        // ids()[i] owns position i of every store of the group
+        std::span<const entity_id> ids() {
+            refresh();
+            return lead().ids().first(packed);
+        }
+
+        // Calls fn(entity_id, Ts&...) for every entity of the group, in
+        // order. Like the pages of a store, this is the bulk path and stamps
+        // nothing, touch() the components fn changed
+        template<typename F>
+        void each(F&& fn) {
+            refresh();
+
+            const auto eids { lead().ids() };
+            for ( index i = 0; i < packed; ++i ) {
+                fn(eids[i], (*std::get<components<Ts>*>(stores))[i]...);
+            }
+        }
+
+        // Sorts the group by comp(const T&, const T&), T being one of Ts,
+        // and reorders the other stores to match
+        template<component_type T, typename Compare>
+        void sort(Compare comp) {
+            refresh();
+
+            const auto& by { *std::get<components<T>*>(stores) };
+
+            std::vector<index> order(packed);
+            std::iota(order.begin(), order.end(), index { 0 });
+            std::sort(order.begin(), order.end(), [&](index a, index b) {
+                return comp(by[a], by[b]);
+            });
+
+            std::vector<index> perm {};
+            ((perm = order, std::get<components<Ts>*>(stores)->permute(perm)),
+             ...);
+
+            remember();
+        }
+    };
+
+}  // namespace ecs
+
+#endif
@@ -0,0 +1,215 @@
+#include "handles.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ecs {
+
+    handle_allocator::~handle_allocator() {
+        for ( uint32_t i = 0; i < max_pages; ++i ) {
+            delete pages[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<uint32_t>& handle_allocator::generation(uint32_t inx) {
+        auto& slot { pages[inx >> page_bits] };
+        auto  pg { slot.load(std::memory_order_acquire) };
+
+        if ( !pg ) {
+            // value-initialized, every generation starts at 0, "never used"
+            auto fresh { new page {} };
+
+            if ( slot.compare_exchange_strong(pg, fresh) ) {
+                pg = fresh;
+            }
+            else {
+                // another thread got there first, `pg` now holds its page
+                delete fresh;
+            }
+        }
+
+        return (*pg)[inx & (page_size - 1)];
+    }
+
+    entity_id handle_allocator::issue(uint32_t inx) {
+        if ( inx >= max_entities ) {
+            throw std::length_error("Out of entity indices");
+        }
+
+        generation(inx).store(1, std::memory_order_release);
+        alive_count.fetch_add(1, std::memory_order_relaxed);
+
+        return { inx, 1 };
+    }
+
+    entity_id handle_allocator::create() {
+        // reuse the most recently freed index, its pages are likely warm
+        if ( !free_indices.empty() ) {
+            const auto inx { free_indices.back() };
+            free_indices.pop_back();
+
+            auto& gen { generation(inx) };
+            auto  revived { gen.load(std::memory_order_relaxed) & ~dead_bit };
+            gen.store(revived, std::memory_order_release);
+            alive_count.fetch_add(1, std::memory_order_relaxed);
+
+            return { inx, revived };
+        }
+
+        return issue(next_index.fetch_add(1));
+    }
+
+    void handle_allocator::create(std::span<entity_id> out) {
+        const auto reused { std::min(out.size(), free_indices.size()) };
+        const auto fresh { out.size() - reused };
+
+        // the fresh range is claimed first, in one atomic step, so running
+        // out of indices throws with nothing handed out or used up
+        auto first { next_index.load(std::memory_order_relaxed) };
+        do {
+            if ( fresh > max_entities - std::min(first, max_entities) ) {
+                throw std::length_error("Out of entity indices");
+            }
+        } while ( fresh != 0
+                  && !next_index.compare_exchange_weak(
+                    first, first + static_cast<uint32_t>(fresh)) );
+
+        for ( size_t i = 0; i < reused; ++i ) {
+            out[i] = create();
+        }
+
+        for ( uint32_t i = 0; i < fresh; ++i ) {
+            generation(first + i).store(1, std::memory_order_release);
+            out[reused + i] = { first + i, 1 };
+        }
+
+        alive_count.fetch_add(fresh, std::memory_order_relaxed);
+    }
+
+    entity_id handle_allocator::create_concurrent() {
+        auto& block { blocks.local() };
+
+        if ( block.next == block.end ) {
+            const auto first { next_index.fetch_add(block_size) };
+            block = { first, first + block_size };
+        }
+
+        return issue(block.next++);
+    }
+
+    void handle_allocator::reclaim() {
+        blocks.for_each([&](index_block& block) {
+            const auto end { std::min(block.end, max_entities) };
+
+            // backwards, so the lowest index is the first one reused. They
+            // were never handed out, reviving them gives generation 1
+            for ( auto inx { end }; inx > block.next; ) {
+                --inx;
+                generation(inx).store(1 | dead_bit, std::memory_order_release);
+                free_indices.push_back(inx);
+            }
+
+            block.next = block.end;
+        });
+    }
+
+    void handle_allocator::retire(entity_id eid) {
+        // stale handles to this index stop matching. Generations wrap within
+        // the bits below dead_bit, skipping 0 which is reserved for null
+        auto next { (eid.generation + 1) & ~dead_bit };
+        if ( next == 0 ) next = 1;
+
+        generation(eid.index).store(next | dead_bit, std::memory_order_release);
+        free_indices.push_back(eid.index);
+    }
+
+    void handle_allocator::release(entity_id eid) {
+        if ( !alive(eid) ) return;
+
+        retire(eid);
+        alive_count.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void handle_allocator::release(std::span<const entity_id> ids) {
+        free_indices.reserve(free_indices.size() + ids.size());
+
+        // an id listed twice is dead by its second time
+        size_t released {};
+        for ( auto eid : ids ) {
+            if ( !alive(eid) ) continue;
+
+            retire(eid);
+            ++released;
+        }
+
+        alive_count.fetch_sub(released, std::memory_order_relaxed);
+    }
+
+    std::vector<uint32_t> handle_allocator::generations() const {
+        std::vector<uint32_t> gens(std::min(extent(), max_entities));
+
+        for ( uint32_t inx = 0; inx < gens.size(); ++inx ) {
+            const auto pg { pages[inx >> page_bits].load(
+              std::memory_order_acquire) };
+            gens[inx] = pg ? (*pg)[inx & (page_size - 1)].load(
+                               std::memory_order_relaxed)
+                           : 0;
+        }
+
+        return gens;
+    }
+
+    void handle_allocator::restore(std::span<const uint32_t> gens) {
+        if ( gens.size() > max_entities ) {
+            throw std::length_error("Out of entity indices");
+        }
+
+        for ( uint32_t p = 0; p < max_pages; ++p ) {
+            if ( auto pg { pages[p].load(std::memory_order_relaxed) } ) {
+                for ( auto& gen : *pg ) {
+                    gen.store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        free_indices.clear();
+        size_t alive { 0 };
+
+        // walked backwards so the lowest index is the first one reused
+        for ( auto inx { static_cast<uint32_t>(gens.size()) }; inx-- > 0; ) {
+            if ( gens[inx] == 0 ) continue;
+
+            generation(inx).store(gens[inx], std::memory_order_release);
+            if ( gens[inx] & dead_bit ) {
+                free_indices.push_back(inx);
+            }
+            else {
+                ++alive;
+            }
+        }
+
+        next_index.store(static_cast<uint32_t>(gens.size()));
+        alive_count.store(alive, std::memory_order_relaxed);
+
+        // blocks reserved before may reach past the restored indices
+        blocks.for_each([](index_block& block) { block.next = block.end; });
+    }
+
+    bool handle_allocator::alive(entity_id eid) const {
+        if ( !eid || eid.index >= max_entities ) return false;
+
+        const auto& slot { pages[eid.index >> page_bits] };
+        const auto  pg { slot.load(std::memory_order_acquire) };
+        if ( !pg ) return false;
+
+        const auto& gen { (*pg)[eid.index & (page_size - 1)] };
+        return gen.load(std::memory_order_acquire) == eid.generation;
+    }
+
+    bool handle_allocator::alive_in(std::span<const uint32_t> gens,
+                                    entity_id                 eid) {
+        return eid && eid.index < gens.size() && !(eid.generation & dead_bit)
+            && gens[eid.index] == eid.generation;
+    }
+
+}  // namespace ecs
@@ -0,0 +1,121 @@
+#ifndef POTATO_ECS_HANDLES_HPP
+#define POTATO_ECS_HANDLES_HPP
+
+#include "per_thread.hpp"
+#include "utils.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace ecs {
+
+    // Hands out and tracks generational entity handles for a context.
+    //
+    // Generations live in pages that are allocated on first use and never
+    // move, so alive() and the creation of fresh handles are safe from any
+    // thread. Reusing and releasing indices goes through a plain free list,
+    // create() and release() must stay on one thread at a time, typically
+    // the one that owns the context.
+    class handle_allocator {
+      public:
+        static constexpr uint32_t page_bits    = 16;
+        static constexpr uint32_t page_size    = 1u << page_bits;
+        static constexpr uint32_t max_pages    = 1u << 12;
+        static constexpr uint32_t max_entities = page_size * max_pages;
+
+        // fresh indices a thread grabs at once in create_concurrent()
+        static constexpr uint32_t block_size = 256;
+
+      private:
+        // set on the stored generation while an index sits in the free list
+        static constexpr uint32_t dead_bit = 1u << 31;
+
+        using page = std::array<std::atomic<uint32_t>, page_size>;
+
+        std::unique_ptr<std::atomic<page*>[]> pages {
+            std::make_unique<std::atomic<page*>[]>(max_pages)
+        };
+
+        std::atomic<uint32_t> next_index { 0 };
+        std::atomic<size_t>   alive_count { 0 };
+        std::vector<uint32_t> free_indices {};
+
+        // fresh indices a thread may hand out, [next, end)
+        struct index_block {
+            uint32_t next {};
+            uint32_t end {};
+        };
+
+        per_thread<index_block> blocks {};
+
+        std::atomic<uint32_t>& generation(uint32_t inx);
+        entity_id              issue(uint32_t inx);
+
+        // marks alive eid dead and frees its index, without counting it
+        void retire(entity_id eid);
+
+      public:
+        handle_allocator() = default;
+        ~handle_allocator();
+
+        // no copy, no move, other threads hold on to it
+        handle_allocator(const handle_allocator&) = delete;
+        handle_allocator& operator=(const handle_allocator&) = delete;
+
+        // Reuses a released index if there is one. Owner thread only
+        entity_id create();
+
+        // Fills `out` with handles, reusing released indices first and taking
+        // the rest as one contiguous range. Throws std::length_error, with
+        // nothing handed out, if that range does not fit. Owner thread only
+        void create(std::span<entity_id> out);
+
+        // Only ever hands out fresh indices, drawn from a block reserved by
+        // the calling thread, so concurrent callers never contend beyond one
+        // atomic add per block. Safe from any thread
+        entity_id create_concurrent();
+
+        // Queues what is left of every thread's create_concurrent() block
+        // for reuse, so blocks of threads that stopped creating, or exited,
+        // are not lost. Owner thread only, while no other thread creates
+        // handles
+        void reclaim();
+
+        // Invalidates eid and queues its index for reuse. Owner thread only
+        void release(entity_id eid);
+
+        // Same for every alive id in ids, with one update of the count
+        void release(std::span<const entity_id> ids);
+
+        bool alive(entity_id eid) const;
+
+        // Same for generations saved by generations()
+        static bool alive_in(std::span<const uint32_t> generations,
+                             entity_id                 eid);
+
+        // Stored generation of every index below extent(), with the dead
+        // bit set on released ones. Owner thread only
+        std::vector<uint32_t> generations() const;
+
+        // Drops every handle and takes over generations saved by
+        // generations(), so the same handles are alive again. Blocks
+        // reserved by create_concurrent() are given up. Owner thread only,
+        // while no other thread creates handles
+        void restore(std::span<const uint32_t> generations);
+
+        size_t size() const {
+            return alive_count.load(std::memory_order_relaxed);
+        }
+
+        // One past the highest index handed out so far
+        uint32_t extent() const {
+            return next_index.load(std::memory_order_relaxed);
+        }
+    };
+
+}  // namespace ecs
+
+#endif
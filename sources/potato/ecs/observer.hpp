@@ -0,0 +1,148 @@
+#ifndef POTATO_ECS_OBSERVER_HPP
+#define POTATO_ECS_OBSERVER_HPP
+
+#include "per_thread.hpp"
+#include "utils.hpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ecs {
+
+    // What happened to an entity's component. The values are bits, an
+    // event_mask can hold any of them
+    enum class component_event : uint8_t {
+        added   = 1,
+        changed = 2,
+        removed = 4,
+    };
+
+    using event_mask = uint8_t;
+
+    inline constexpr event_mask all_events = 1 | 2 | 4;
+
+    constexpr event_mask operator|(component_event a, component_event b) {
+        return static_cast<event_mask>(a) | static_cast<event_mask>(b);
+    }
+
+    struct event {
+        entity_id       eid {};
+        component_event kind {};
+    };
+
+    // Where a store records the events of one subscriber until it drains
+    // them. Adds and removals only ever come from the thread that owns the
+    // context and are kept in order. Changes can come from systems running
+    // on any thread, and go to a list per thread
+    class event_sink {
+      private:
+        template<component_type T>
+        friend class components;
+
+        event_mask mask {};
+
+        std::vector<event>                 structural {};
+        per_thread<std::vector<entity_id>> changes {};
+
+        // the store recording into this sink, null once it is gone
+        const icomponents* source {};
+
+        bool wants(component_event kind) const {
+            return (mask & static_cast<event_mask>(kind)) != 0;
+        }
+
+        void record(entity_id eid, component_event kind) {
+            if ( wants(kind) ) structural.push_back({ eid, kind });
+        }
+
+        void record_change(entity_id eid) {
+            if ( wants(component_event::changed) ) {
+                changes.local().push_back(eid);
+            }
+        }
+
+      public:
+        explicit event_sink(event_mask mask = all_events)
+          : mask { mask } {}
+
+        // no copy, no move, stores hold on to it
+        event_sink(const event_sink&) = delete;
+        event_sink& operator=(const event_sink&) = delete;
+
+        // false once the store is destroyed
+        bool attached() const {
+            return source != nullptr;
+        }
+
+        // Calls fn(const event&) for everything recorded since the last
+        // drain, then forgets it. Must not run while the store is used
+        template<typename F>
+        void drain(F&& fn) {
+            for ( const auto& e : structural ) {
+                fn(e);
+            }
+            structural.clear();
+
+            changes.for_each([&](std::vector<entity_id>& list) {
+                for ( auto eid : list ) {
+                    const event e { eid, component_event::changed };
+                    fn(e);
+                }
+                list.clear();
+            });
+        }
+    };
+
+    // Batches the add, change and remove events of one components<T> store,
+    // for whoever mirrors the store elsewhere, like instance buffers or
+    // physics proxies. Recording an event is a push_back, and keeping up
+    // with the store costs as much as what changed since the last drain
+    // rather than the size of the store:
+    //
+    //   ecs::observer<transform> moved { ctx.get_component<transform>() };
+    //   ...
+    //   moved.drain([&](const ecs::event& e) { ... });
+    //
+    // Adds and removals come first, in the order they happened. A component
+    // that is removed and added again shows up as both. Changes follow, they
+    // are recorded whenever get(), get_at() or touch() stamp a component,
+    // once per tick of the context's clock, and may name entities removed
+    // since, check contains(). Components added during a tick do not count
+    // as changed in that tick. Handing out references through get() is
+    // what counts as a change, not writing through them.
+    //
+    // Observers must be destroyed before their store, or after the store is
+    // destroyed, never at the same time as it is used
+    template<component_type T>
+    requires(!soa_component<T>)
+    class observer {
+      private:
+        components<T>* store {};
+        event_sink     sink;
+
+      public:
+        explicit observer(components<T>& s, event_mask mask = all_events)
+          : store { &s }
+          , sink { mask } {
+            store->subscribe(sink);
+        }
+
+        ~observer() {
+            if ( sink.attached() ) store->unsubscribe(sink);
+        }
+
+        // no copy, no move, the store holds on to it
+        observer(const observer&) = delete;
+        observer& operator=(const observer&) = delete;
+
+        // See event_sink::drain
+        template<typename F>
+        void drain(F&& fn) {
+            sink.drain(std::forward<F>(fn));
+        }
+    };
+
+}  // namespace ecs
+
+#endif
@@ -0,0 +1,334 @@
+#ifndef POTATO_ECS_PAGED_VECTOR_HPP
+#define POTATO_ECS_PAGED_VECTOR_HPP
+
+#include "core/memory.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ecs {
+
+    // Vector of T kept in fixed size pages of PageSize elements. Growing
+    // only ever allocates a new page, nothing is copied and references to
+    // elements stay valid until the element itself is removed or moved by
+    // the owner. Pages are cache line aligned, and with Huge set, pages of
+    // at least potato::memory::huge_page bytes are backed by huge pages
+    // where the platform allows it.
+    //
+    // Elements are not contiguous as a whole, only within a page, see
+    // page(). Pages are kept once allocated, until shrink_to_fit().
+    template<typename T, size_t PageSize, bool Huge = false>
+    class paged_vector {
+        static_assert(std::has_single_bit(PageSize),
+                      "Page size must be a power of two");
+
+      public:
+        using value_type = T;
+
+        static constexpr size_t page_size = PageSize;
+
+      private:
+        static constexpr size_t shift { std::countr_zero(PageSize) };
+        static constexpr size_t mask { PageSize - 1 };
+        static constexpr size_t page_bytes { PageSize * sizeof(T) };
+
+        std::vector<T*> pages {};
+        size_t          count {};
+
+        T* slot(size_t i) const {
+            return pages[i >> shift] + (i & mask);
+        }
+
+        void grow() {
+            pages.push_back(static_cast<T*>(potato::memory::allocate_block(
+              page_bytes, alignof(T), Huge)));
+        }
+
+        void release(size_t keep) {
+            while ( pages.size() > keep ) {
+                potato::memory::free_block(
+                  pages.back(), page_bytes, alignof(T), Huge);
+                pages.pop_back();
+            }
+        }
+
+      public:
+        template<bool Const>
+        class basic_iterator {
+          private:
+            using owner_t = std::conditional_t<Const,
+                                               const paged_vector,
+                                               paged_vector>;
+
+            owner_t* owner {};
+            size_t   pos {};
+
+          public:
+            using value_type        = T;
+            using reference         = std::conditional_t<Const, const T&, T&>;
+            using pointer           = std::conditional_t<Const, const T*, T*>;
+            using difference_type   = std::ptrdiff_t;
+            using iterator_category = std::random_access_iterator_tag;
+
+            basic_iterator() = default;
+
+            basic_iterator(owner_t* o, size_t p)
+              : owner { o }
+              , pos { p } {}
+
+            // iterator to const_iterator
+            operator basic_iterator<true>() const
+              requires(!Const)
+            {
+                return { owner, pos };
+            }
+
+            reference operator*() const {
+                return *owner->slot(pos);
+            }
+
+            pointer operator->() const {
+                return owner->slot(pos);
+            }
+
+            reference operator[](difference_type n) const {
+                return *owner->slot(pos + n);
+            }
+
+            basic_iterator& operator++() {
+                ++pos;
+                return *this;
+            }
+
+            basic_iterator operator++(int) {
+                auto old { *this };
+                ++pos;
+                return old;
+            }
+
+            basic_iterator& operator--() {
+                --pos;
+                return *this;
+            }
+
+            basic_iterator operator--(int) {
+                auto old { *this };
+                --pos;
+                return old;
+            }
+
+            basic_iterator& operator+=(difference_type n) {
+                pos += n;
+                return *this;
+            }
+
+            basic_iterator& operator-=(difference_type n) {
+                pos -= n;
+                return *this;
+            }
+
+            friend basic_iterator operator+(basic_iterator it,
+                                            difference_type n) {
+                return it += n;
+            }
+
+            friend basic_iterator operator+(difference_type n,
+                                            basic_iterator it) {
+                return it += n;
+            }
+
+            friend basic_iterator operator-(basic_iterator it,
+                                            difference_type n) {
+                return it -= n;
+            }
+
+            friend difference_type operator-(const basic_iterator& a,
+                                             const basic_iterator& b) {
+                return static_cast<difference_type>(a.pos)
+                     - static_cast<difference_type>(b.pos);
+            }
+
+            bool operator==(const basic_iterator& other) const {
+                return pos == other.pos;
+            }
+
+            auto operator<=>(const basic_iterator& other) const {
+                return pos <=> other.pos;
+            }
+        };
+
+        using iterator       = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        paged_vector() = default;
+
+        ~paged_vector() {
+            clear();
+            release(0);
+        }
+
+        // no copy
+        paged_vector(const paged_vector&) = delete;
+        paged_vector& operator=(const paged_vector&) = delete;
+
+        // allow move
+        paged_vector(paged_vector&& other) noexcept
+          : pages { std::move(other.pages) }
+          , count { std::exchange(other.count, 0) } {
+            other.pages.clear();
+        }
+
+        paged_vector& operator=(paged_vector&& other) noexcept {
+            if ( this != &other ) {
+                clear();
+                release(0);
+                pages = std::move(other.pages);
+                count = std::exchange(other.count, 0);
+                other.pages.clear();
+            }
+            return *this;
+        }
+
+        template<typename... Args>
+        T& emplace_back(Args&&... args) {
+            if ( count == capacity() ) grow();
+
+            auto item { std::construct_at(slot(count),
+                                          std::forward<Args>(args)...) };
+            ++count;
+            return *item;
+        }
+
+        void push_back(const T& value) {
+            emplace_back(value);
+        }
+
+        void push_back(T&& value) {
+            emplace_back(std::move(value));
+        }
+
+        // Copies `values` to the back, one page worth at a time
+        void append(std::span<const T> values) {
+            reserve(count + values.size());
+
+            while ( !values.empty() ) {
+                const auto room { PageSize - (count & mask) };
+                const auto n { std::min(room, values.size()) };
+
+                std::uninitialized_copy_n(values.begin(), n, slot(count));
+                count += n;
+                values = values.subspan(n);
+            }
+        }
+
+        void assign(std::span<const T> values) {
+            clear();
+            append(values);
+        }
+
+        void pop_back() {
+            assert(count > 0);
+            std::destroy_at(slot(--count));
+        }
+
+        // Destroys every element, the pages are kept for reuse
+        void clear() {
+            if constexpr ( !std::is_trivially_destructible_v<T> ) {
+                for ( size_t i = 0; i < count; ++i ) {
+                    std::destroy_at(slot(i));
+                }
+            }
+            count = 0;
+        }
+
+        // Allocates pages until n elements fit
+        void reserve(size_t n) {
+            pages.reserve((n + mask) >> shift);
+            while ( capacity() < n ) grow();
+        }
+
+        // Frees the pages past the last element
+        void shrink_to_fit() {
+            release((count + mask) >> shift);
+        }
+
+        T& operator[](size_t i) {
+            assert(i < count);
+            return *slot(i);
+        }
+
+        const T& operator[](size_t i) const {
+            assert(i < count);
+            return *slot(i);
+        }
+
+        T& back() {
+            return (*this)[count - 1];
+        }
+
+        const T& back() const {
+            return (*this)[count - 1];
+        }
+
+        size_t size() const {
+            return count;
+        }
+
+        bool empty() const {
+            return count == 0;
+        }
+
+        size_t capacity() const {
+            return pages.size() * PageSize;
+        }
+
+        // Number of pages holding elements, page(p) is the p-th of them
+        size_t page_count() const {
+            return (count + mask) >> shift;
+        }
+
+        std::span<T> page(size_t p) {
+            return { pages[p], std::min(PageSize, count - (p << shift)) };
+        }
+
+        std::span<const T> page(size_t p) const {
+            return { pages[p], std::min(PageSize, count - (p << shift)) };
+        }
+
+        iterator begin() {
+            return { this, 0 };
+        }
+
+        iterator end() {
+            return { this, count };
+        }
+
+        const_iterator begin() const {
+            return { this, 0 };
+        }
+
+        const_iterator end() const {
+            return { this, count };
+        }
+
+        const_iterator cbegin() const {
+            return begin();
+        }
+
+        const_iterator cend() const {
+            return end();
+        }
+    };
+
+}  // namespace ecs
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef POTATO_ECS_PER_THREAD_HPP
+#define POTATO_ECS_PER_THREAD_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ecs {
+
+    // One lazily created instance of T per thread that touches the owning
+    // object. Threads only take a lock the first time they ask for their
+    // instance, after that local() is an index into a thread-local table.
+    //
+    // Every live owner has a small slot in that table. Slots are handed
+    // back when an owner goes away and reused, so the tables only grow with
+    // the number of owners alive at once, not with every owner ever made,
+    // like short lived command buffers or observers.
+    template<typename T>
+    class per_thread {
+      private:
+        // hands out the smallest slot no live owner holds
+        class slot_pool {
+          private:
+            std::mutex            mut {};
+            std::vector<uint32_t> released {};
+            uint32_t              next {};
+
+          public:
+            uint32_t acquire() {
+                std::scoped_lock lock { mut };
+                if ( released.empty() ) return next++;
+
+                const auto s { released.back() };
+                released.pop_back();
+                return s;
+            }
+
+            void release(uint32_t s) {
+                std::scoped_lock lock { mut };
+                released.push_back(s);
+            }
+        };
+
+        // what a thread remembers of the owner in one slot
+        struct cached {
+            uint64_t serial {};
+            T*       instance {};
+        };
+
+        static slot_pool& slots() {
+            static slot_pool pool {};
+            return pool;
+        }
+
+        static uint64_t next_serial() {
+            static std::atomic<uint64_t> counter { 1 };
+            return counter.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::mutex                      mut {};
+        std::vector<std::unique_ptr<T>> instances {};
+
+        const uint32_t slot { slots().acquire() };
+
+        // Unique for the life of the process, so that a thread never takes
+        // the instance it cached for a dead owner in the same slot
+        const uint64_t serial { next_serial() };
+
+      public:
+        per_thread() = default;
+
+        ~per_thread() {
+            slots().release(slot);
+        }
+
+        // no copy, no move, threads hold on to the instances
+        per_thread(const per_thread&) = delete;
+        per_thread& operator=(const per_thread&) = delete;
+
+        // The calling thread's instance
+        T& local() {
+            thread_local std::vector<cached> known {};
+
+            if ( slot >= known.size() ) known.resize(size_t(slot) + 1);
+
+            auto& entry { known[slot] };
+            if ( entry.serial != serial ) {
+                std::scoped_lock lock { mut };
+                instances.push_back(std::make_unique<T>());
+                entry = { serial, instances.back().get() };
+            }
+
+            return *entry.instance;
+        }
+
+        // Calls fn(T&) on every thread's instance. The threads must not be
+        // using their instances while this runs
+        template<typename F>
+        void for_each(F&& fn) {
+            std::scoped_lock lock { mut };
+            for ( auto& i : instances ) {
+                fn(*i);
+            }
+        }
+    };
+
+}  // namespace ecs
+
+#endif
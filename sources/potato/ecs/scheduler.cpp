@@ -0,0 +1,60 @@
+#include "scheduler.hpp"
+
+#include <atomic>
+
+namespace ecs {
+
+    scheduler::scheduler(potato::jobs::pool& pool)
+      : workers { pool } {}
+
+    void scheduler::build_graph() {
+        for ( auto& n : nodes ) {
+            n.successors.clear();
+            n.predecessors = 0;
+        }
+
+        // an edge from every system to each later system it conflicts with,
+        // so conflicting systems keep the order they were added in
+        for ( size_t i = 0; i < nodes.size(); ++i ) {
+            for ( size_t j = i + 1; j < nodes.size(); ++j ) {
+                if ( nodes[i].acc.conflicts(nodes[j].acc) ) {
+                    nodes[i].successors.push_back(j);
+                    ++nodes[j].predecessors;
+                }
+            }
+        }
+
+        graph_dirty = false;
+    }
+
+    void scheduler::run(context& ctx) {
+        if ( graph_dirty ) build_graph();
+        if ( nodes.empty() ) return;
+
+        potato::jobs::task_group group { workers };
+
+        std::vector<std::atomic<size_t>> waiting_on(nodes.size());
+        for ( size_t i = 0; i < nodes.size(); ++i ) {
+            waiting_on[i].store(nodes[i].predecessors);
+        }
+
+        // Each finished system releases its successors. The group catches
+        // exceptions, and wait() rethrows the first one once all is done.
+        std::function<void(size_t)> launch = [&](size_t current) {
+            group.run([&, current] {
+                nodes[current].fn(ctx);
+
+                for ( auto next : nodes[current].successors ) {
+                    if ( waiting_on[next].fetch_sub(1) == 1 ) launch(next);
+                }
+            });
+        };
+
+        for ( size_t i = 0; i < nodes.size(); ++i ) {
+            if ( nodes[i].predecessors == 0 ) launch(i);
+        }
+
+        group.wait();
+    }
+
+}  // namespace ecs
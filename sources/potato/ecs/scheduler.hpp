@@ -0,0 +1,105 @@
+#ifndef POTATO_ECS_SCHEDULER_HPP
+#define POTATO_ECS_SCHEDULER_HPP
+
+#include "core/jobs.hpp"
+#include "utils.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ecs {
+
+    // Component access a system declares, used to decide which systems may
+    // run at the same time
+    struct access {
+        signature reads {};
+        signature writes {};
+
+        // true if running both at once could race on a component
+        bool conflicts(const access& other) const {
+            return writes.intersects(other.reads)
+                || writes.intersects(other.writes)
+                || other.writes.intersects(reads);
+        }
+    };
+
+    template<component_type... Ts>
+    struct reads {
+        static void declare(access& a) {
+            (a.reads.set(type_id<Ts>()), ...);
+        }
+    };
+
+    template<component_type... Ts>
+    struct writes {
+        static void declare(access& a) {
+            (a.writes.set(type_id<Ts>()), ...);
+        }
+    };
+
+    // A unit of per-frame work, along with the components it touches, as in
+    //
+    //   ecs::system<ecs::reads<transform>, ecs::writes<render_instance>> {
+    //       "build instances", [](ecs::context& ctx) { ... } }
+    //
+    // Systems must only touch the components they declare, and must not add
+    // or remove entities or components while the scheduler runs.
+    template<typename... Access>
+    struct system {
+        std::string                   name {};
+        std::function<void(context&)> fn {};
+
+        static access declared() {
+            access a {};
+            (Access::declare(a), ...);
+            return a;
+        }
+    };
+
+    // Runs systems as tasks on a job pool. Two systems that conflict on a
+    // component run in the order they were added, everything else may
+    // overlap.
+    class scheduler {
+      private:
+        struct node {
+            std::string                   name {};
+            access                        acc {};
+            std::function<void(context&)> fn {};
+            std::vector<size_t>           successors {};
+            size_t                        predecessors {};
+        };
+
+        std::vector<node>   nodes {};
+        potato::jobs::pool& workers;
+        bool                graph_dirty { true };
+
+        void build_graph();
+
+      public:
+        explicit scheduler(potato::jobs::pool& = potato::jobs::pool::shared());
+
+        template<typename... Access>
+        scheduler& add(system<Access...> s) {
+            nodes.push_back({
+              .name = std::move(s.name),
+              .acc  = system<Access...>::declared(),
+              .fn   = std::move(s.fn),
+            });
+            graph_dirty = true;
+            return *this;
+        }
+
+        // Runs every system once, returns when all of them have finished.
+        // Rethrows the first exception thrown by a system, systems that
+        // depend on one that threw are skipped.
+        void run(context&);
+
+        size_t size() const {
+            return nodes.size();
+        }
+    };
+
+}  // namespace ecs
+
+#endif
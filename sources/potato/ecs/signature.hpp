@@ -0,0 +1,191 @@
+#ifndef POTATO_ECS_SIGNATURE_HPP
+#define POTATO_ECS_SIGNATURE_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace ecs {
+
+    // Set of component types, one bit per type id. Grows to fit the highest
+    // id set, so the number of component types is not capped. Trailing
+    // zero words are never stored, equal sets always compare equal.
+    class signature {
+      private:
+        static constexpr size_t word_bits = 64;
+
+        std::vector<uint64_t> words {};
+
+        void trim() {
+            while ( !words.empty() && words.back() == 0 ) {
+                words.pop_back();
+            }
+        }
+
+      public:
+        signature() = default;
+
+        signature& set(size_t bit) {
+            if ( bit / word_bits >= words.size() ) {
+                words.resize(bit / word_bits + 1);
+            }
+            words[bit / word_bits] |= uint64_t(1) << (bit % word_bits);
+            return *this;
+        }
+
+        signature& reset(size_t bit) {
+            if ( bit / word_bits < words.size() ) {
+                words[bit / word_bits] &= ~(uint64_t(1) << (bit % word_bits));
+                trim();
+            }
+            return *this;
+        }
+
+        bool test(size_t bit) const {
+            return bit / word_bits < words.size()
+                && (words[bit / word_bits] >> (bit % word_bits) & 1);
+        }
+
+        bool any() const {
+            return !words.empty();
+        }
+
+        size_t count() const {
+            size_t n {};
+            for ( auto w : words ) {
+                n += std::popcount(w);
+            }
+            return n;
+        }
+
+        // true if every bit of `other` is set here too
+        bool contains(const signature& other) const {
+            if ( other.words.size() > words.size() ) return false;
+
+            for ( size_t i = 0; i < other.words.size(); ++i ) {
+                if ( (words[i] & other.words[i]) != other.words[i] ) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // true if both have at least one bit in common
+        bool intersects(const signature& other) const {
+            const auto n { std::min(words.size(), other.words.size()) };
+
+            for ( size_t i = 0; i < n; ++i ) {
+                if ( words[i] & other.words[i] ) return true;
+            }
+            return false;
+        }
+
+        // Calls fn(bit) for every bit set, lowest first
+        template<typename F>
+        void for_each(F&& fn) const {
+            for ( size_t i = 0; i < words.size(); ++i ) {
+                for ( auto w { words[i] }; w != 0; w &= w - 1 ) {
+                    fn(i * word_bits + std::countr_zero(w));
+                }
+            }
+        }
+
+        size_t hash() const {
+            size_t h { words.size() };
+            for ( auto w : words ) {
+                h ^= std::hash<uint64_t> {}(w) + 0x9e3779b97f4a7c15
+                   + (h << 6) + (h >> 2);
+            }
+            return h;
+        }
+
+        bool operator==(const signature&) const = default;
+    };
+
+    // Component masks of all the entities of a context, indexed by entity
+    // index. Every mask is a row of `stride` words in one flat array, so
+    // there is no allocation per entity. The rows widen when a context
+    // registers a type id past the current width.
+    class entity_masks {
+      private:
+        static constexpr size_t word_bits = 64;
+
+        size_t                stride { 1 };
+        std::vector<uint64_t> words {};
+
+        size_t rows() const {
+            return words.size() / stride;
+        }
+
+      public:
+        entity_masks() = default;
+
+        // Makes room for bits [0, bits) in every row
+        void fit(size_t bits) {
+            const auto wanted { (bits + word_bits - 1) / word_bits };
+            if ( wanted <= stride ) return;
+
+            std::vector<uint64_t> wider(rows() * wanted);
+            for ( size_t r = 0; r < rows(); ++r ) {
+                std::copy_n(&words[r * stride], stride, &wider[r * wanted]);
+            }
+
+            words  = std::move(wider);
+            stride = wanted;
+        }
+
+        void set(uint32_t inx, size_t bit) {
+            assert(bit < stride * word_bits);
+            if ( inx >= rows() ) {
+                words.resize((size_t(inx) + 1) * stride);
+            }
+            words[inx * stride + bit / word_bits] |= uint64_t(1)
+                                                  << (bit % word_bits);
+        }
+
+        void reset(uint32_t inx, size_t bit) {
+            if ( inx < rows() && bit < stride * word_bits ) {
+                words[inx * stride + bit / word_bits] &=
+                  ~(uint64_t(1) << (bit % word_bits));
+            }
+        }
+
+        bool test(uint32_t inx, size_t bit) const {
+            return inx < rows() && bit < stride * word_bits
+                && (words[inx * stride + bit / word_bits] >> (bit % word_bits)
+                    & 1);
+        }
+
+        void clear(uint32_t inx) {
+            if ( inx < rows() ) {
+                std::fill_n(&words[inx * stride], stride, 0);
+            }
+        }
+
+        // Calls fn(bit) for every bit set in the row of inx, lowest first.
+        // fn may reset bits of the row while this runs
+        template<typename F>
+        void for_each(uint32_t inx, F&& fn) const {
+            if ( inx >= rows() ) return;
+
+            for ( size_t i = 0; i < stride; ++i ) {
+                for ( auto w { words[inx * stride + i] }; w != 0; w &= w - 1 ) {
+                    fn(i * word_bits + std::countr_zero(w));
+                }
+            }
+        }
+    };
+
+}  // namespace ecs
+
+template<>
+struct std::hash<ecs::signature> {
+    size_t operator()(const ecs::signature& s) const {
+        return s.hash();
+    }
+};
+
+#endif
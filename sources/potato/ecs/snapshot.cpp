@@ -0,0 +1,219 @@
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+
+namespace {
+    constexpr std::array<char, 8> magic { 'P', 'O', 'T', 'A',
+                                          'T', 'O', 'S', 'N' };
+
+    // written as is, reads back differently on the other byte order
+    constexpr uint32_t byte_order_mark { 0x01020304 };
+
+    // every array in the file starts on this boundary
+    constexpr uint64_t blob_align { 64 };
+
+    struct file_header {
+        std::array<char, 8> tag {};
+        uint32_t            version {};
+        uint32_t            byte_order {};
+        uint32_t            extent {};
+        uint32_t            stores {};
+    };
+
+    struct section_header {
+        uint64_t key {};
+        uint64_t count {};
+        uint32_t columns {};
+        uint32_t reserved {};
+    };
+
+    struct column_header {
+        uint32_t element_size {};
+        uint32_t element_align {};
+    };
+
+    uint64_t aligned(uint64_t offset) {
+        return (offset + blob_align - 1) & ~(blob_align - 1);
+    }
+
+    // reads the file front to back, checking every read against its end
+    class cursor {
+      private:
+        std::span<const std::byte> bytes;
+        uint64_t                   offset {};
+
+      public:
+        explicit cursor(std::span<const std::byte> b)
+          : bytes { b } {}
+
+        std::span<const std::byte> take(uint64_t size) {
+            if ( size > bytes.size() - offset ) {
+                throw std::runtime_error("Snapshot file is truncated");
+            }
+
+            const auto blob { bytes.subspan(offset, size) };
+            offset += size;
+            return blob;
+        }
+
+        uint64_t left() const {
+            return bytes.size() - offset;
+        }
+
+        template<typename T>
+        T read() {
+            T value {};
+            std::memcpy(&value, take(sizeof(T)).data(), sizeof(T));
+            return value;
+        }
+
+        // count elements of `size` bytes on the next boundary
+        std::span<const std::byte> blob(uint64_t count, uint64_t size) {
+            offset = std::min<uint64_t>(aligned(offset), bytes.size());
+
+            if ( size != 0 && count > (bytes.size() - offset) / size ) {
+                throw std::runtime_error("Snapshot file is truncated");
+            }
+
+            return take(count * size);
+        }
+
+        // an array of count T on the next boundary, in place
+        template<typename T>
+        std::span<const T> array(uint64_t count) {
+            const auto b { blob(count, sizeof(T)) };
+            return { reinterpret_cast<const T*>(b.data()), count };
+        }
+    };
+}  // namespace
+
+namespace ecs {
+
+    snapshot_writer::snapshot_writer(const std::string&        fname,
+                                     std::span<const uint32_t> generations)
+      : file { fname, std::ios::binary | std::ios::trunc } {
+
+        if ( !file.is_open() ) {
+            throw std::runtime_error("Could not open file for writing");
+        }
+
+        // the store count is patched in by finish()
+        const file_header header { magic,
+                                   snapshot_version,
+                                   byte_order_mark,
+                                   static_cast<uint32_t>(generations.size()),
+                                   0 };
+        write(&header, sizeof(header));
+
+        pad();
+        write(generations.data(), generations.size_bytes());
+    }
+
+    void snapshot_writer::write(const void* data, size_t size) {
+        file.write(static_cast<const char*>(data),
+                   static_cast<std::streamsize>(size));
+        offset += size;
+    }
+
+    void snapshot_writer::pad() {
+        static constexpr std::array<char, blob_align> zeros {};
+        write(zeros.data(), aligned(offset) - offset);
+    }
+
+    void snapshot_writer::store(uint64_t                   key,
+                                std::span<const entity_id> ids,
+                                uint32_t                   columns) {
+        assert(columns_left == 0 && bytes_left == 0);
+
+        const section_header header { key, ids.size(), columns, 0 };
+        write(&header, sizeof(header));
+
+        pad();
+        write(ids.data(), ids.size_bytes());
+
+        elements     = ids.size();
+        columns_left = columns;
+        ++stores;
+    }
+
+    void snapshot_writer::column(uint32_t element_size,
+                                 uint32_t element_align) {
+        assert(columns_left > 0 && bytes_left == 0);
+
+        if ( element_align > blob_align ) {
+            throw std::logic_error(
+              "Component is too strictly aligned for a snapshot");
+        }
+
+        const column_header header { element_size, element_align };
+        write(&header, sizeof(header));
+        pad();
+
+        --columns_left;
+        bytes_left = elements * element_size;
+    }
+
+    void snapshot_writer::append(std::span<const std::byte> bytes) {
+        assert(bytes.size() <= bytes_left);
+
+        write(bytes.data(), bytes.size());
+        bytes_left -= bytes.size();
+    }
+
+    void snapshot_writer::finish() {
+        assert(columns_left == 0 && bytes_left == 0);
+
+        file.seekp(offsetof(file_header, stores));
+        file.write(reinterpret_cast<const char*>(&stores), sizeof(stores));
+        file.close();
+
+        if ( file.fail() ) {
+            throw std::runtime_error("Could not write snapshot");
+        }
+    }
+
+    snapshot::snapshot(const std::string& fname)
+      : file { fname } {
+
+        cursor in { file.bytes() };
+
+        const auto header { in.read<file_header>() };
+        if ( header.tag != magic ) {
+            throw std::runtime_error("Not a snapshot file");
+        }
+        if ( header.version != snapshot_version
+             || header.byte_order != byte_order_mark )
+        {
+            throw std::runtime_error("Unsupported snapshot version");
+        }
+
+        gens = in.array<uint32_t>(header.extent);
+
+        // the counts come from the file, never reserve more than the rest
+        // of it has headers for
+        sections.reserve(std::min<uint64_t>(
+          header.stores, in.left() / sizeof(section_header)));
+        for ( uint32_t s = 0; s < header.stores; ++s ) {
+            const auto sh { in.read<section_header>() };
+
+            snapshot_section section { sh.key, in.array<entity_id>(sh.count) };
+
+            section.columns.reserve(std::min<uint64_t>(
+              sh.columns, in.left() / sizeof(column_header)));
+            for ( uint32_t c = 0; c < sh.columns; ++c ) {
+                const auto ch { in.read<column_header>() };
+
+                section.columns.push_back(
+                  { ch.element_size,
+                    ch.element_align,
+                    in.blob(sh.count, ch.element_size) });
+            }
+
+            sections.push_back(std::move(section));
+        }
+    }
+
+}  // namespace ecs
@@ -0,0 +1,189 @@
+#ifndef POTATO_ECS_SNAPSHOT_HPP
+#define POTATO_ECS_SNAPSHOT_HPP
+
+#include "core/mapped_file.hpp"
+#include "utils.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace ecs {
+
+    // Bumped whenever the layout of snapshot files changes
+    inline constexpr uint32_t snapshot_version = 1;
+
+    // One column of a store as it sits in a snapshot, `bytes` holds
+    // element_size bytes per entity
+    struct snapshot_column {
+        uint32_t                   element_size {};
+        uint32_t                   element_align {};
+        std::span<const std::byte> bytes {};
+    };
+
+    // Everything one store saved. A components<T> store has a single
+    // column, a soa_components<T> store one per declared field
+    struct snapshot_section {
+        uint64_t                     key {};
+        std::span<const entity_id>   ids {};
+        std::vector<snapshot_column> columns {};
+
+        // Throws std::runtime_error unless the section has `count` columns
+        void expect_columns(size_t count) const {
+            if ( columns.size() != count ) {
+                throw std::runtime_error(
+                  "Snapshot layout does not match the component");
+            }
+        }
+
+        // Throws std::runtime_error unless column i was saved as an array
+        // of E, going by the size and alignment it was saved with
+        template<typename E>
+        void expect_column(size_t i) const {
+            if ( i >= columns.size() || columns[i].element_size != sizeof(E)
+                 || columns[i].element_align != alignof(E) )
+            {
+                throw std::runtime_error(
+                  "Snapshot layout does not match the component");
+            }
+        }
+
+        // Column i as an array of E, see expect_column()
+        template<typename E>
+        std::span<const E> column(size_t i) const {
+            expect_column<E>(i);
+
+            // the file was written from live objects of E, which are
+            // trivially copyable
+            return { reinterpret_cast<const E*>(columns[i].bytes.data()),
+                     ids.size() };
+        }
+    };
+
+    // Streams a snapshot file out, see context::save
+    class snapshot_writer {
+      private:
+        std::ofstream file;
+        uint64_t      offset {};
+        uint32_t      stores {};
+
+        // what the current section still owes, checked in debug builds
+        uint64_t elements {};
+        uint32_t columns_left {};
+        uint64_t bytes_left {};
+
+        void write(const void* data, size_t size);
+        void pad();
+
+      public:
+        // Throws std::runtime_error if the file cannot be created
+        snapshot_writer(const std::string&        fname,
+                        std::span<const uint32_t> generations);
+
+        // no copy
+        snapshot_writer(const snapshot_writer&) = delete;
+        snapshot_writer& operator=(const snapshot_writer&) = delete;
+
+        // Starts the section of a store. It must be followed by `columns`
+        // calls to column(), each appending the bytes of ids.size()
+        // elements, in as many pieces as the store keeps them in
+        void store(uint64_t                   key,
+                   std::span<const entity_id> ids,
+                   uint32_t                   columns);
+
+        void column(uint32_t element_size, uint32_t element_align);
+        void append(std::span<const std::byte> bytes);
+
+        // Completes the header, nothing may be written afterwards
+        void finish();
+    };
+
+    // A snapshot file, memory mapped. Files are laid out as
+    //
+    //   header, entity generations
+    //   per store: section header, ids, then per column a column header
+    //   and the raw elements
+    //
+    // with every array starting on a 64 byte boundary, so the columns can
+    // be used in place. Integers are in the byte order of the writer, files
+    // from a machine with another byte order or another version are
+    // rejected. Hand it to context::load to bring a world back, or read the
+    // components straight out of the mapping for worlds that are only read.
+    class snapshot {
+      private:
+        potato::utils::mapped_file    file;
+        std::span<const uint32_t>     gens {};
+        std::vector<snapshot_section> sections {};
+
+      public:
+        // Throws std::runtime_error if the file is not a valid snapshot
+        explicit snapshot(const std::string& fname);
+
+        // no copy
+        snapshot(const snapshot&) = delete;
+        snapshot& operator=(const snapshot&) = delete;
+
+        // allow move
+        snapshot(snapshot&&)            = default;
+        snapshot& operator=(snapshot&&) = default;
+
+        // Handle generations by entity index, see
+        // handle_allocator::generations()
+        std::span<const uint32_t> generations() const {
+            return gens;
+        }
+
+        std::span<const snapshot_section> stores() const {
+            return sections;
+        }
+
+        const snapshot_section* find(uint64_t key) const {
+            for ( const auto& s : sections ) {
+                if ( s.key == key ) return &s;
+            }
+            return nullptr;
+        }
+
+        template<component_type T>
+        const snapshot_section* find() const {
+            return find(type_key<T>());
+        }
+
+        // Entities that had a T when the snapshot was taken, in step with
+        // items<T>() and column<M>()
+        template<component_type T>
+        std::span<const entity_id> ids() const {
+            const auto s { find<T>() };
+            return s ? s->ids : std::span<const entity_id> {};
+        }
+
+        // The saved T components, read in place from the mapping
+        template<component_type T>
+        requires(!soa_component<T>)
+        std::span<const T> items() const {
+            const auto s { find<T>() };
+            return s ? s->template column<T>(0) : std::span<const T> {};
+        }
+
+        // The saved column of field M of a structure-of-arrays component
+        template<auto M>
+        std::span<const internal::member_t<M>> column() const {
+            using T = internal::class_t<M>;
+            using E = internal::member_t<M>;
+
+            const auto s { find<T>() };
+            if ( !s ) return {};
+
+            return s->template column<E>(
+              internal::field_index<M>(typename T::fields {}));
+        }
+    };
+
+}  // namespace ecs
+
+#endif
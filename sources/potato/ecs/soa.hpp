@@ -0,0 +1,450 @@
+#ifndef POTATO_ECS_SOA_HPP
+#define POTATO_ECS_SOA_HPP
+
+#include "component.hpp"
+#include "per_thread.hpp"
+#include "snapshot.hpp"
+#include "sparse_set.hpp"
+#include "utils.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <concepts>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ecs {
+
+    // Store for components that declare their fields, as in
+    //
+    //   struct particle {
+    //       glm::vec3 position {};
+    //       glm::vec3 velocity {};
+    //       using fields = ecs::fields<&particle::position,
+    //                                  &particle::velocity>;
+    //   };
+    //
+    // Every field lives in a column of its own, so a system that only reads
+    // positions streams only the position column, and column<M>() hands SIMD
+    // kernels contiguous arrays. Every member of T must be in the list, a
+    // missing one would not be stored and come back default initialized,
+    // so the store checks what it can of that at compile time.
+    //
+    // get() hands out a proxy rather than a T&. Fields are reached through
+    // get<&T::field>(), the whole component is read by converting the proxy
+    // to T and written by assigning a T to it. Take view elements with
+    // `auto&&` rather than `auto&` so both store kinds work.
+    template<component_type T>
+    class soa_components final : public icomponents {
+        static_assert(soa_component<T>,
+                      "Declare the fields of T with ecs::fields to use it "
+                      "with a structure-of-arrays store");
+
+      public:
+        using type  = T;
+        using index = sparse_set::index;
+
+      private:
+        template<typename>
+        struct layout;
+
+        template<auto... Ms>
+        struct layout<fields<Ms...>> {
+            using columns = std::tuple<std::vector<internal::member_t<Ms>>...>;
+            static constexpr auto members { std::make_tuple(Ms...) };
+
+            static constexpr bool trivially_copyable {
+                (std::is_trivially_copyable_v<internal::member_t<Ms>> && ...)
+            };
+        };
+
+        using field_list = typename T::fields;
+        using columns_t  = typename layout<field_list>::columns;
+
+        static_assert(internal::declares_all<T>(field_list {}),
+                      "Declare every member of T in its ecs::fields");
+
+        static constexpr size_t field_count { std::tuple_size_v<columns_t> };
+
+        template<size_t I>
+        static constexpr auto member { std::get<I>(
+          layout<field_list>::members) };
+
+        template<auto M>
+        static constexpr size_t column_index() {
+            constexpr auto i { internal::field_index<M>(field_list {}) };
+            static_assert(i < field_count, "Not a declared field of T");
+            return i;
+        }
+
+        static constexpr auto all_fields {
+            std::make_index_sequence<field_count> {}
+        };
+
+        // components added through add_concurrent by one thread
+        struct stage {
+            std::vector<entity::id> ids {};
+            std::vector<T>          items {};
+        };
+
+        // entities.entities()[i] owns row i of every column, last changed
+        // at tick changed[i]
+        sparse_set          entities {};
+        columns_t           columns {};
+        std::vector<tick_t> changed {};
+
+        // boxed like components<T>::staged
+        std::unique_ptr<per_thread<stage>> staged {
+            std::make_unique<per_thread<stage>>()
+        };
+
+        entity_masks*              masks {};
+        size_t                     bit { type_id<T>() };
+        const std::atomic<tick_t>* clock {};
+
+        tick_t now() const {
+            return clock ? clock->load(std::memory_order_relaxed) : 0;
+        }
+
+        template<size_t... I>
+        void push(T&& value, std::index_sequence<I...>) {
+            (std::get<I>(columns).push_back(std::move(value.*member<I>)), ...);
+        }
+
+        template<size_t... I>
+        void scatter(index inx, const T& value, std::index_sequence<I...>) {
+            ((std::get<I>(columns)[inx] = value.*member<I>), ...);
+        }
+
+        // T is rebuilt from its columns alone, see declares_all
+        template<size_t... I>
+        T gather(index inx, std::index_sequence<I...>) const {
+            T value {};
+            ((value.*member<I> = std::get<I>(columns)[inx]), ...);
+            return value;
+        }
+
+        template<size_t... I>
+        void move_row(index to, index from, std::index_sequence<I...>) {
+            ((std::get<I>(columns)[to] = std::move(std::get<I>(columns)[from])),
+             ...);
+        }
+
+        template<size_t... I>
+        void pop_row(std::index_sequence<I...>) {
+            (std::get<I>(columns).pop_back(), ...);
+        }
+
+        template<size_t... I>
+        void reserve_rows(size_t n, std::index_sequence<I...>) {
+            (std::get<I>(columns).reserve(n), ...);
+        }
+
+        template<size_t... I>
+        void clear_rows(std::index_sequence<I...>) {
+            (std::get<I>(columns).clear(), ...);
+        }
+
+        template<size_t... I>
+        void save_rows(snapshot_writer& out, std::index_sequence<I...>) const {
+            out.store(key(), ids(), field_count);
+
+            auto save_column = [&](const auto& column) {
+                using E = typename std::decay_t<decltype(column)>::value_type;
+                out.column(sizeof(E), alignof(E));
+                out.append(std::as_bytes(std::span { column }));
+            };
+            (save_column(std::get<I>(columns)), ...);
+        }
+
+        template<size_t... I>
+        void check_rows(const snapshot_section& in,
+                        std::index_sequence<I...>) const {
+            in.expect_columns(field_count);
+            (in.expect_column<
+               typename std::tuple_element_t<I, columns_t>::value_type>(I),
+             ...);
+        }
+
+        template<size_t... I>
+        void load_rows(const snapshot_section& in, std::index_sequence<I...>) {
+            in.expect_columns(field_count);
+
+            auto load_column = [&](auto& column, size_t i) {
+                using E = typename std::decay_t<decltype(column)>::value_type;
+                const auto values { in.column<E>(i) };
+                column.assign(values.begin(), values.end());
+            };
+            (load_column(std::get<I>(columns), I), ...);
+        }
+
+        void mark(entity::id eid) {
+            changed.push_back(now());
+            if ( masks ) masks->set(eid.index, bit);
+        }
+
+      public:
+        // Stands in for a T& to one row of the store
+        template<bool Const>
+        class basic_ref {
+          private:
+            using store_t = std::conditional_t<Const,
+                                               const soa_components,
+                                               soa_components>;
+
+            store_t* store {};
+            index    inx {};
+
+          public:
+            basic_ref(store_t* s, index i)
+              : store { s }
+              , inx { i } {}
+
+            basic_ref(const basic_ref&) = default;
+
+            template<auto M>
+            auto& get() const {
+                return std::get<column_index<M>()>(store->columns)[inx];
+            }
+
+            operator T() const {
+                return store->gather(inx, all_fields);
+            }
+
+            // Assignment writes through, it never rebinds the proxy
+            const basic_ref& operator=(const T& value) const
+              requires(!Const)
+            {
+                store->scatter(inx, value, all_fields);
+                return *this;
+            }
+
+            const basic_ref& operator=(const basic_ref& other) const
+              requires(!Const)
+            {
+                return *this = static_cast<T>(other);
+            }
+        };
+
+        using reference       = basic_ref<false>;
+        using const_reference = basic_ref<true>;
+
+        explicit soa_components(entity_masks*              masks = nullptr,
+                                const std::atomic<tick_t>* clock = nullptr)
+          : masks { masks }
+          , clock { clock } {}
+
+        ~soa_components() = default;
+
+        // no copy
+        soa_components(const soa_components&) = delete;
+        soa_components& operator=(const soa_components&) = delete;
+
+        // allow move
+        soa_components(soa_components&&) = default;
+        soa_components& operator=(soa_components&&) = default;
+
+        // Throws std::logic_error if eid has a T already
+        template<typename... Args>
+        reference add(entity::id eid, Args... args) {
+            if ( contains(eid) ) {
+                throw std::logic_error("Entity already has component");
+            }
+
+            push(T { std::forward<Args>(args)... }, all_fields);
+            const auto inx { entities.insert(eid) };
+            mark(eid);
+
+            return { this, inx };
+        }
+
+        // Like components<T>::add_bulk, adds nothing if an id has a T
+        // already or shows up twice
+        void add_bulk(std::span<const entity::id> ids,
+                      std::span<const T>          values) {
+            assert(ids.size() == values.size());
+            reserve(size() + ids.size());
+            entities.insert(ids);
+
+            for ( size_t i = 0; i < ids.size(); ++i ) {
+                push(T { values[i] }, all_fields);
+                mark(ids[i]);
+            }
+        }
+
+        template<std::invocable<entity::id> F>
+        void add_bulk(std::span<const entity::id> ids, F&& make) {
+            reserve(size() + ids.size());
+            entities.insert(ids);
+
+            for ( auto eid : ids ) {
+                push(T { make(eid) }, all_fields);
+                mark(eid);
+            }
+        }
+
+        bool contains(entity::id eid) const {
+            return entities.contains(eid);
+        }
+
+        // Mutable access counts as a change, like components<T>::get()
+        reference get(entity::id eid) {
+            const auto inx { entities.find(eid) };
+
+            if ( inx == sparse_set::npos ) {
+                throw std::out_of_range("Entity does not have component");
+            }
+
+            changed[inx] = now();
+            return { this, inx };
+        }
+
+        const_reference get_const(entity::id eid) const {
+            const auto inx { entities.find(eid) };
+
+            if ( inx == sparse_set::npos ) {
+                throw std::out_of_range("Entity does not have component");
+            }
+
+            return { this, inx };
+        }
+
+        tick_t changed_at(entity::id eid) const {
+            const auto inx { entities.find(eid) };
+            return inx != sparse_set::npos ? changed[inx] : 0;
+        }
+
+        void touch(entity::id eid) {
+            changed[entities.index_of(eid)] = now();
+        }
+
+        // Column of field M, column<M>()[i] belongs to ids()[i]. Writes
+        // through it are not tracked, see touch()
+        template<auto M>
+        std::span<internal::member_t<M>> column() {
+            return std::get<column_index<M>()>(columns);
+        }
+
+        template<auto M>
+        std::span<const internal::member_t<M>> column() const {
+            return std::get<column_index<M>()>(columns);
+        }
+
+        template<typename... Args>
+        void add_concurrent(entity::id eid, Args... args) {
+            auto& local { staged->local() };
+            local.ids.push_back(eid);
+            local.items.push_back(T { std::forward<Args>(args)... });
+        }
+
+        void flush(const context& ctx) override {
+            staged->for_each([&](stage& s) {
+                for ( size_t i = 0; i < s.ids.size(); ++i ) {
+                    if ( ctx.alive(s.ids[i]) && !contains(s.ids[i]) ) {
+                        add(s.ids[i], std::move(s.items[i]));
+                    }
+                }
+                s.ids.clear();
+                s.items.clear();
+            });
+        }
+
+        void remove(entity::id eid) override {
+            if ( !contains(eid) ) return;
+
+            // same swap-and-pop as components<T>, once per column
+            auto inx { entities.erase(eid) };
+            if ( masks ) masks->reset(eid.index, bit);
+
+            const auto last { static_cast<index>(changed.size() - 1) };
+            if ( inx != last ) {
+                move_row(inx, last, all_fields);
+                changed[inx] = changed.back();
+            }
+
+            pop_row(all_fields);
+            changed.pop_back();
+        }
+
+        void remove_bulk(std::span<const entity::id> ids) override {
+            for ( auto eid : ids ) {
+                remove(eid);
+            }
+        }
+
+        void reserve(size_t n) {
+            entities.reserve(n);
+            reserve_rows(n, all_fields);
+            changed.reserve(n);
+        }
+
+        void clear() override {
+            if ( masks ) {
+                for ( auto eid : ids() ) {
+                    masks->reset(eid.index, bit);
+                }
+            }
+
+            entities.clear();
+            clear_rows(all_fields);
+            changed.clear();
+        }
+
+        uint64_t key() const override {
+            return type_key<T>();
+        }
+
+        // Every column is saved as an array of its own
+        void save(snapshot_writer& out) const override {
+            if constexpr ( layout<field_list>::trivially_copyable ) {
+                save_rows(out, all_fields);
+            }
+        }
+
+        // One column per declared field, in the order of the field list
+        void check_layout(const snapshot_section& in) const override {
+            if constexpr ( layout<field_list>::trivially_copyable ) {
+                check_rows(in, all_fields);
+            }
+        }
+
+        void load(const snapshot_section& in) override {
+            clear();
+
+            if constexpr ( layout<field_list>::trivially_copyable ) {
+                load_rows(in, all_fields);
+                entities.insert(in.ids);
+                changed.assign(in.ids.size(), now());
+
+                if ( !masks ) return;
+                for ( auto eid : in.ids ) {
+                    masks->set(eid.index, bit);
+                }
+            }
+        }
+
+        size_t size() const {
+            return changed.size();
+        }
+
+        bool empty() const {
+            return changed.empty();
+        }
+
+        std::span<const entity::id> ids() const {
+            return entities.entities();
+        }
+
+        std::span<const tick_t> changes() const {
+            return changed;
+        }
+    };
+
+}  // namespace ecs
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef POTATO_ECS_SPARSE_SET_HPP
+#define POTATO_ECS_SPARSE_SET_HPP
+
+#include "entity.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace ecs {
+
+    // Maps entity ids to a packed range of indices [0, size). The sparse side
+    // is paged and indexed directly by the entity index, so lookups never
+    // hash, and only pages that actually hold an entity are allocated. The
+    // dense side is a plain array of ids, which the owning store keeps in step
+    // with its own array of items. Ids whose generation does not match the one
+    // stored are treated as absent.
+    class sparse_set {
+      public:
+        using index = uint32_t;
+
+        static constexpr index  npos      = std::numeric_limits<index>::max();
+        static constexpr size_t page_size = 4096;
+
+      private:
+        using page = std::unique_ptr<index[]>;
+
+        std::vector<page>       sparse {};
+        std::vector<entity::id> dense {};
+
+        static constexpr size_t page_of(entity::id eid) {
+            return eid.index / page_size;
+        }
+
+        static constexpr size_t offset_of(entity::id eid) {
+            return eid.index % page_size;
+        }
+
+        // dense index stored for eid's index, regardless of generation
+        index slot(entity::id eid) const {
+            const auto pg { page_of(eid) };
+            return pg < sparse.size() && sparse[pg]
+                   ? sparse[pg][offset_of(eid)]
+                   : npos;
+        }
+
+        index& sparse_ref(entity::id eid) {
+            const auto pg { page_of(eid) };
+
+            if ( pg >= sparse.size() ) {
+                sparse.resize(pg + 1);
+            }
+
+            if ( !sparse[pg] ) {
+                sparse[pg] = std::make_unique<index[]>(page_size);
+                std::fill_n(sparse[pg].get(), page_size, npos);
+            }
+
+            return sparse[pg][offset_of(eid)];
+        }
+
+      public:
+        sparse_set() = default;
+
+        // no copy
+        sparse_set(const sparse_set&) = delete;
+        sparse_set& operator=(const sparse_set&) = delete;
+
+        // allow move
+        sparse_set(sparse_set&&) = default;
+        sparse_set& operator=(sparse_set&&) = default;
+
+        bool contains(entity::id eid) const {
+            const auto inx { slot(eid) };
+            return inx != npos && dense[inx] == eid;
+        }
+
+        // Dense index of `eid`, or npos if it is not in the set
+        index find(entity::id eid) const {
+            const auto inx { slot(eid) };
+            return inx != npos && dense[inx] == eid ? inx : npos;
+        }
+
+        // Dense index of `eid`. `eid` must be in the set
+        index index_of(entity::id eid) const {
+            assert(contains(eid));
+            return sparse[page_of(eid)][offset_of(eid)];
+        }
+
+        // Appends `eid` to the dense array and returns its index
+        index insert(entity::id eid) {
+            assert(slot(eid) == npos);
+            const auto inx { static_cast<index>(dense.size()) };
+            dense.push_back(eid);
+            sparse_ref(eid) = inx;
+            return inx;
+        }
+
+        // Appends all of `eids` in order and returns the index of the first.
+        // Grows the sparse side once for the highest page touched. Throws
+        // std::logic_error, leaving the set as it was, if an id is in the
+        // set already or shows up twice
+        index insert(std::span<const entity::id> eids) {
+            const auto first { static_cast<index>(dense.size()) };
+            if ( eids.empty() ) return first;
+
+            const auto highest {
+                std::ranges::max(eids, {}, &entity::id::index)
+            };
+            if ( page_of(highest) >= sparse.size() ) {
+                sparse.resize(page_of(highest) + 1);
+            }
+
+            dense.insert(dense.end(), eids.begin(), eids.end());
+
+            auto inx { first };
+            for ( auto eid : eids ) {
+                if ( slot(eid) != npos ) {
+                    // ids before this one are new, take them out again
+                    for ( auto i { first }; i < inx; ++i ) {
+                        sparse_ref(dense[i]) = npos;
+                    }
+                    dense.resize(first);
+
+                    throw std::logic_error("Entity is already in the set");
+                }
+                sparse_ref(eid) = inx++;
+            }
+
+            return first;
+        }
+
+        // Removes `eid` by moving the last id into its slot, and returns the
+        // index that was vacated. Owners mirror this by moving their last item
+        // into the returned index and popping the back.
+        index erase(entity::id eid) {
+            const auto inx { index_of(eid) };
+            const auto last { dense.back() };
+
+            dense[inx]                             = last;
+            sparse[page_of(last)][offset_of(last)] = inx;
+            sparse[page_of(eid)][offset_of(eid)]   = npos;
+            dense.pop_back();
+
+            return inx;
+        }
+
+        // Exchanges the ids at dense indices a and b. Owners mirror this by
+        // swapping their items at a and b
+        void swap(index a, index b) {
+            std::swap(dense[a], dense[b]);
+            sparse[page_of(dense[a])][offset_of(dense[a])] = a;
+            sparse[page_of(dense[b])][offset_of(dense[b])] = b;
+        }
+
+        void reserve(size_t n) {
+            dense.reserve(n);
+        }
+
+        void clear() {
+            for ( auto eid : dense ) {
+                sparse[page_of(eid)][offset_of(eid)] = npos;
+            }
+            dense.clear();
+        }
+
+        size_t size() const {
+            return dense.size();
+        }
+
+        bool empty() const {
+            return dense.empty();
+        }
+
+        std::span<const entity::id> entities() const {
+            return dense;
+        }
+
+        auto begin() const {
+            return dense.cbegin();
+        }
+
+        auto end() const {
+            return dense.cend();
+        }
+    };
+
+}  // namespace ecs
+
+#endif
@@ -0,0 +1,572 @@
+#include "spatial.hpp"
+
+#include "component.hpp"
+#include "transform.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+namespace {
+    // the box around the part of r up to max_distance, if that is finite
+    std::optional<potato::math::aabb> segment(const potato::math::ray& r,
+                                              float max_distance) {
+        if ( !std::isfinite(max_distance) ) return std::nullopt;
+
+        const auto end { r.origin + r.direction * max_distance };
+        return potato::math::aabb { glm::min(r.origin, end),
+                                    glm::max(r.origin, end) };
+    }
+}  // namespace
+
+namespace ecs {
+
+    namespace spatial {
+
+        bvh::bvh(float m)
+          : margin { m } {}
+
+        uint32_t bvh::allocate() {
+            if ( free_list == npos ) {
+                nodes.emplace_back();
+                return static_cast<uint32_t>(nodes.size() - 1);
+            }
+
+            const auto n { free_list };
+            free_list = nodes[n].parent;
+            nodes[n]  = {};
+            return n;
+        }
+
+        void bvh::release(uint32_t n) {
+            nodes[n]        = {};
+            nodes[n].parent = free_list;
+            nodes[n].height = npos;
+            free_list       = n;
+        }
+
+        void bvh::insert_leaf(uint32_t leaf) {
+            if ( root == npos ) {
+                root               = leaf;
+                nodes[leaf].parent = npos;
+                return;
+            }
+
+            const auto box { nodes[leaf].box };
+
+            // walk down as long as pushing the leaf into a child is cheaper
+            // than pairing it with the current node
+            auto sibling { root };
+            while ( !nodes[sibling].leaf() ) {
+                const auto& n { nodes[sibling] };
+
+                const float combined { aabb::merge(n.box, box).surface_area() };
+                const float pair { 2.f * combined };
+                // every ancestor of the new parent grows by as much
+                const float inherited { 2.f
+                                        * (combined - n.box.surface_area()) };
+
+                auto descend = [&](uint32_t child) {
+                    const auto& c { nodes[child] };
+                    const float grown {
+                        aabb::merge(c.box, box).surface_area()
+                    };
+                    return inherited
+                         + (c.leaf() ? grown : grown - c.box.surface_area());
+                };
+
+                const float left { descend(n.left) };
+                const float right { descend(n.right) };
+
+                if ( pair < left && pair < right ) break;
+                sibling = left < right ? n.left : n.right;
+            }
+
+            const auto old_parent { nodes[sibling].parent };
+            const auto parent { allocate() };
+
+            nodes[parent].parent = old_parent;
+            nodes[parent].left   = sibling;
+            nodes[parent].right  = leaf;
+            nodes[parent].box    = aabb::merge(nodes[sibling].box, box);
+            nodes[parent].height = nodes[sibling].height + 1;
+
+            nodes[sibling].parent = parent;
+            nodes[leaf].parent    = parent;
+
+            if ( old_parent == npos ) {
+                root = parent;
+            }
+            else if ( nodes[old_parent].left == sibling ) {
+                nodes[old_parent].left = parent;
+            }
+            else {
+                nodes[old_parent].right = parent;
+            }
+
+            fix_upwards(parent);
+        }
+
+        void bvh::remove_leaf(uint32_t leaf) {
+            if ( leaf == root ) {
+                root = npos;
+                return;
+            }
+
+            const auto parent { nodes[leaf].parent };
+            const auto grand { nodes[parent].parent };
+            const auto sibling { nodes[parent].left == leaf
+                                   ? nodes[parent].right
+                                   : nodes[parent].left };
+
+            nodes[sibling].parent = grand;
+            nodes[leaf].parent    = npos;
+
+            if ( grand == npos ) {
+                root = sibling;
+            }
+            else {
+                if ( nodes[grand].left == parent ) {
+                    nodes[grand].left = sibling;
+                }
+                else {
+                    nodes[grand].right = sibling;
+                }
+                fix_upwards(grand);
+            }
+
+            release(parent);
+        }
+
+        void bvh::fix_upwards(uint32_t n) {
+            while ( n != npos ) {
+                n = balance(n);
+
+                auto&       a { nodes[n] };
+                const auto& l { nodes[a.left] };
+                const auto& r { nodes[a.right] };
+
+                a.height = 1 + std::max(l.height, r.height);
+                a.box    = aabb::merge(l.box, r.box);
+
+                n = a.parent;
+            }
+        }
+
+        // Rotates the taller child of a up when the heights of a's children
+        // differ by more than one, returns the node now in a's place
+        uint32_t bvh::balance(uint32_t a) {
+            auto& A { nodes[a] };
+            if ( A.leaf() || A.height < 2 ) return a;
+
+            const auto b { A.left };
+            const auto c { A.right };
+            auto&      B { nodes[b] };
+            auto&      C { nodes[c] };
+
+            const auto diff { static_cast<int64_t>(C.height)
+                              - static_cast<int64_t>(B.height) };
+
+            if ( diff > 1 ) {
+                const auto f { C.left };
+                const auto g { C.right };
+                auto&      F { nodes[f] };
+                auto&      G { nodes[g] };
+
+                C.left   = a;
+                C.parent = A.parent;
+                A.parent = c;
+
+                if ( C.parent == npos ) {
+                    root = c;
+                }
+                else if ( nodes[C.parent].left == a ) {
+                    nodes[C.parent].left = c;
+                }
+                else {
+                    nodes[C.parent].right = c;
+                }
+
+                // the taller grandchild stays under c
+                const bool keep_f { F.height > G.height };
+                const auto kept { keep_f ? f : g };
+                const auto moved { keep_f ? g : f };
+
+                C.right             = kept;
+                A.right             = moved;
+                nodes[moved].parent = a;
+
+                A.box    = aabb::merge(B.box, nodes[moved].box);
+                A.height = 1 + std::max(B.height, nodes[moved].height);
+                C.box    = aabb::merge(A.box, nodes[kept].box);
+                C.height = 1 + std::max(A.height, nodes[kept].height);
+                return c;
+            }
+
+            if ( diff < -1 ) {
+                const auto d { B.left };
+                const auto e { B.right };
+                auto&      D { nodes[d] };
+                auto&      E { nodes[e] };
+
+                B.left   = a;
+                B.parent = A.parent;
+                A.parent = b;
+
+                if ( B.parent == npos ) {
+                    root = b;
+                }
+                else if ( nodes[B.parent].left == a ) {
+                    nodes[B.parent].left = b;
+                }
+                else {
+                    nodes[B.parent].right = b;
+                }
+
+                const bool keep_d { D.height > E.height };
+                const auto kept { keep_d ? d : e };
+                const auto moved { keep_d ? e : d };
+
+                B.right             = kept;
+                A.left              = moved;
+                nodes[moved].parent = a;
+
+                A.box    = aabb::merge(C.box, nodes[moved].box);
+                A.height = 1 + std::max(C.height, nodes[moved].height);
+                B.box    = aabb::merge(A.box, nodes[kept].box);
+                B.height = 1 + std::max(A.height, nodes[kept].height);
+                return b;
+            }
+
+            return a;
+        }
+
+        bvh::proxy bvh::insert(const aabb& box, uint32_t value) {
+            const auto leaf { allocate() };
+            nodes[leaf].box   = box.expanded(margin);
+            nodes[leaf].value = value;
+
+            insert_leaf(leaf);
+            ++leaves;
+            return leaf;
+        }
+
+        void bvh::remove(proxy p) {
+            assert(p < nodes.size() && nodes[p].leaf());
+            remove_leaf(p);
+            release(p);
+            --leaves;
+        }
+
+        bool bvh::move(proxy p, const aabb& box) {
+            assert(p < nodes.size() && nodes[p].leaf());
+            if ( nodes[p].box.contains(box) ) return false;
+
+            if ( !overlaps(nodes[p].box, box) ) {
+                remove_leaf(p);
+                nodes[p].box = box.expanded(margin);
+                insert_leaf(p);
+                return true;
+            }
+
+            // still close to where it was, the tree keeps its shape and
+            // only the boxes above the leaf change
+            nodes[p].box = box.expanded(margin);
+            for ( auto n { nodes[p].parent }; n != npos; n = nodes[n].parent ) {
+                nodes[n].box = aabb::merge(nodes[nodes[n].left].box,
+                                           nodes[nodes[n].right].box);
+            }
+            return true;
+        }
+
+        void bvh::clear() {
+            nodes.clear();
+            root      = npos;
+            free_list = npos;
+            leaves    = 0;
+        }
+
+        grid::grid(float size)
+          : cell_size { size } {}
+
+        uint32_t grid::find_cell(const glm::vec3& p) {
+            const auto [it, added] {
+                cell_of.try_emplace(key(coord(p.x), coord(p.y), coord(p.z)),
+                                    static_cast<uint32_t>(cells.size()))
+            };
+            if ( added ) cells.emplace_back();
+            return it->second;
+        }
+
+        void grid::place(uint32_t handle, const aabb& box, uint32_t value) {
+            const auto c { find_cell(box.center()) };
+            auto&      target { cells[c] };
+
+            const auto e { box.extents() };
+            reach = std::max({ reach, e.x, e.y, e.z });
+
+            target.box = target.members.empty() ? box
+                                                : aabb::merge(target.box, box);
+
+            proxies[handle] = {
+                .cell = c,
+                .slot = static_cast<uint32_t>(target.members.size()),
+            };
+            target.members.push_back({ box, value, handle });
+        }
+
+        grid::member grid::take(uint32_t handle) {
+            const auto loc { proxies[handle] };
+            auto&      source { cells[loc.cell] };
+
+            const auto m { source.members[loc.slot] };
+
+            source.members[loc.slot] = source.members.back();
+            proxies[source.members[loc.slot].handle].slot = loc.slot;
+            source.members.pop_back();
+
+            // the only place where the box of a cell shrinks
+            if ( !source.members.empty() ) {
+                source.box = source.members.front().box;
+                for ( const auto& other : source.members ) {
+                    source.box = aabb::merge(source.box, other.box);
+                }
+            }
+
+            return m;
+        }
+
+        grid::proxy grid::insert(const aabb& box, uint32_t value) {
+            proxy p { free_list };
+            if ( p == npos ) {
+                p = static_cast<proxy>(proxies.size());
+                proxies.emplace_back();
+            }
+            else {
+                free_list = proxies[p].slot;
+            }
+
+            place(p, box, value);
+            ++count;
+            return p;
+        }
+
+        void grid::remove(proxy p) {
+            assert(p < proxies.size() && proxies[p].cell != npos);
+            take(p);
+
+            proxies[p] = { .cell = npos, .slot = free_list };
+            free_list  = p;
+            --count;
+        }
+
+        bool grid::move(proxy p, const aabb& box) {
+            assert(p < proxies.size() && proxies[p].cell != npos);
+
+            const auto loc { proxies[p] };
+            if ( find_cell(box.center()) != loc.cell ) {
+                place(p, box, take(p).value);
+                return true;
+            }
+
+            auto& c { cells[loc.cell] };
+            c.members[loc.slot].box = box;
+            if ( !c.box.contains(box) ) c.box = aabb::merge(c.box, box);
+
+            const auto e { box.extents() };
+            reach = std::max({ reach, e.x, e.y, e.z });
+            return false;
+        }
+
+        void grid::clear() {
+            cell_of.clear();
+            cells.clear();
+            proxies.clear();
+            free_list = npos;
+            count     = 0;
+            reach     = 0.f;
+        }
+
+    }  // namespace spatial
+
+    spatial_index::spatial_index(spatial_config c)
+      : config { c }
+      , tree { c.margin }
+      , cells { c.cell_size } {}
+
+    uint32_t spatial_index::find(entity_id eid) const {
+        if ( eid.index >= slot_of.size() ) return spatial::npos;
+
+        const auto pos { slot_of[eid.index] };
+        return pos != spatial::npos && entries[pos].eid == eid ? pos
+                                                                : spatial::npos;
+    }
+
+    void spatial_index::insert(entity_id eid, const aabb& box) {
+        if ( eid.index >= slot_of.size() ) {
+            slot_of.resize(size_t(eid.index) + 1, spatial::npos);
+        }
+
+        const auto proxy { config.layout == spatial_layout::bvh
+                             ? tree.insert(box, eid.index)
+                             : cells.insert(box, eid.index) };
+
+        slot_of[eid.index] = static_cast<uint32_t>(entries.size());
+        entries.push_back({ eid, box, proxy, pass });
+    }
+
+    void spatial_index::erase(uint32_t pos) {
+        const auto& e { entries[pos] };
+
+        if ( config.layout == spatial_layout::bvh ) {
+            tree.remove(e.proxy);
+        }
+        else {
+            cells.remove(e.proxy);
+        }
+
+        // a newer entity with the same index may have taken the slot
+        if ( slot_of[e.eid.index] == pos ) {
+            slot_of[e.eid.index] = spatial::npos;
+        }
+
+        const auto last { static_cast<uint32_t>(entries.size() - 1) };
+        if ( pos != last ) {
+            entries[pos] = entries[last];
+            if ( slot_of[entries[pos].eid.index] == last ) {
+                slot_of[entries[pos].eid.index] = pos;
+            }
+        }
+        entries.pop_back();
+    }
+
+    void spatial_index::update(context& ctx) {
+        auto world { ctx.find_component<world_transform>() };
+        auto shapes { ctx.find_component<bounds>() };
+
+        if ( !world || !shapes ) {
+            clear();
+            return;
+        }
+
+        const auto since { std::exchange(last_seen, ctx.advance_tick()) };
+        ++pass;
+
+        const auto ids { shapes->ids() };
+        const auto stamps { shapes->changes() };
+
+        for ( size_t k = 0; k < ids.size(); ++k ) {
+            const auto eid { ids[k] };
+            if ( !world->contains(eid) ) continue;
+
+            const auto pos { find(eid) };
+            if ( pos != spatial::npos && stamps[k] <= since
+                 && world->changed_at(eid) <= since ) {
+                entries[pos].pass = pass;
+                continue;
+            }
+
+            const auto box { shapes->get_const(eid).local.transformed(
+              world->get_const(eid).matrix) };
+
+            if ( pos == spatial::npos ) {
+                insert(eid, box);
+                continue;
+            }
+
+            auto& e { entries[pos] };
+            e.box  = box;
+            e.pass = pass;
+
+            if ( config.layout == spatial_layout::bvh ) {
+                tree.move(e.proxy, box);
+            }
+            else {
+                cells.move(e.proxy, box);
+            }
+        }
+
+        // whatever was not seen lost its bounds or its world transform.
+        // Backwards, so that what erase() moves in was already seen
+        for ( auto pos { entries.size() }; pos-- > 0; ) {
+            if ( entries[pos].pass != pass ) {
+                erase(static_cast<uint32_t>(pos));
+            }
+        }
+    }
+
+    void spatial_index::clear() {
+        tree.clear();
+        cells.clear();
+        entries.clear();
+        slot_of.clear();
+        last_seen = 0;
+    }
+
+    void spatial_index::query(const potato::math::aabb& box,
+                              std::vector<entity_id>&   out) const {
+        visit(
+          box,
+          [&](const aabb& b) { return overlaps(box, b); },
+          [&](const entry& e) { out.push_back(e.eid); });
+    }
+
+    void spatial_index::query(const potato::math::sphere& s,
+                              std::vector<entity_id>&     out) const {
+        const aabb around { s.center - glm::vec3 { s.radius },
+                            s.center + glm::vec3 { s.radius } };
+
+        visit(
+          around,
+          [&](const aabb& b) { return overlaps(s, b); },
+          [&](const entry& e) { out.push_back(e.eid); });
+    }
+
+    void spatial_index::query(const potato::math::frustum& f,
+                              std::vector<entity_id>&      out) const {
+        visit(
+          std::nullopt,
+          [&](const aabb& b) { return overlaps(f, b); },
+          [&](const entry& e) { out.push_back(e.eid); });
+    }
+
+    void spatial_index::query(const potato::math::ray& r,
+                              float                    max_distance,
+                              std::vector<entity_id>&  out) const {
+        visit(
+          segment(r, max_distance),
+          [&](const aabb& b) {
+              return intersect(r, b, max_distance).has_value();
+          },
+          [&](const entry& e) { out.push_back(e.eid); });
+    }
+
+    std::optional<spatial_index::ray_hit>
+      spatial_index::raycast(const potato::math::ray& r,
+                             float                    max_distance) const {
+        std::optional<ray_hit> nearest {};
+
+        // every hit shortens the ray, which prunes what lies behind it
+        visit(
+          segment(r, max_distance),
+          [&](const aabb& b) {
+              return intersect(r, b, max_distance).has_value();
+          },
+          [&](const entry& e) {
+              if ( auto t { intersect(r, e.box, max_distance) } ) {
+                  nearest      = ray_hit { e.eid, *t };
+                  max_distance = *t;
+              }
+          });
+
+        return nearest;
+    }
+
+    const potato::math::aabb& spatial_index::box(entity_id eid) const {
+        const auto pos { find(eid) };
+        assert(pos != spatial::npos);
+        return entries[pos].box;
+    }
+
+}  // namespace ecs
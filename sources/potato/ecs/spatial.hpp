@@ -0,0 +1,358 @@
+#ifndef POTATO_ECS_SPATIAL_HPP
+#define POTATO_ECS_SPATIAL_HPP
+
+#include "context.hpp"
+#include "core/geometry.hpp"
+#include "utils.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Box around an entity's mesh or collider, in its local space. Together with
+// a world_transform it places the entity in an ecs::spatial_index
+struct bounds {
+    potato::math::aabb local { glm::vec3 { -.5f }, glm::vec3 { .5f } };
+};
+
+namespace ecs {
+
+    namespace spatial {
+
+        using potato::math::aabb;
+
+        inline constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+        // Dynamic bounding volume hierarchy over boxes, each tagged with a
+        // caller chosen value. Leaves keep a box grown by `margin`, objects
+        // that move inside of it cost nothing. Small moves past it refit
+        // the leaf's ancestors in place, only large ones reinsert the leaf.
+        // Insertion picks the sibling with the lowest surface area cost and
+        // the tree is rebalanced with rotations on the way up
+        class bvh {
+          private:
+            struct node {
+                aabb box {};
+                // next free node while the node is unused
+                uint32_t parent { npos };
+                uint32_t left { npos };
+                uint32_t right { npos };
+                uint32_t value {};
+                // leaves are 0, unused nodes npos
+                uint32_t height {};
+
+                bool leaf() const {
+                    return left == npos;
+                }
+            };
+
+            std::vector<node> nodes {};
+            uint32_t          root { npos };
+            uint32_t          free_list { npos };
+            size_t            leaves {};
+            float             margin {};
+
+            uint32_t allocate();
+            void     release(uint32_t n);
+
+            void insert_leaf(uint32_t leaf);
+            void remove_leaf(uint32_t leaf);
+
+            // recomputes the boxes and heights from n up, with rotations
+            void fix_upwards(uint32_t n);
+            uint32_t balance(uint32_t a);
+
+          public:
+            using proxy = uint32_t;
+
+            explicit bvh(float margin = .1f);
+
+            proxy insert(const aabb& box, uint32_t value);
+            void  remove(proxy p);
+
+            // Follows an object to `box`, returns false if its leaf
+            // already held it
+            bool move(proxy p, const aabb& box);
+
+            void clear();
+
+            // Calls fn(value) for every leaf whose grown box passes
+            // test(aabb), test also prunes the inner nodes
+            template<typename Test, typename F>
+            void visit(Test&& test, F&& fn) const {
+                if ( root == npos ) return;
+
+                std::vector<uint32_t> stack {};
+                stack.reserve(64);
+                stack.push_back(root);
+
+                while ( !stack.empty() ) {
+                    const auto& n { nodes[stack.back()] };
+                    stack.pop_back();
+
+                    if ( !test(n.box) ) continue;
+
+                    if ( n.leaf() ) {
+                        fn(n.value);
+                    }
+                    else {
+                        stack.push_back(n.left);
+                        stack.push_back(n.right);
+                    }
+                }
+            }
+
+            size_t size() const {
+                return leaves;
+            }
+
+            // 0 for a single leaf or an empty tree
+            uint32_t height() const {
+                return root == npos ? 0 : nodes[root].height;
+            }
+        };
+
+        // Loose uniform grid. Every object lives in the one cell holding
+        // the center of its box, and each cell keeps the union of the boxes
+        // in it, so objects larger than a cell need no duplicates. Meant
+        // for many similar, small objects. Queries with a bounded region
+        // only look up the cells around it, the others go over every
+        // occupied cell
+        class grid {
+          private:
+            struct member {
+                aabb     box {};
+                uint32_t value {};
+                // what insert() returned for it
+                uint32_t handle {};
+            };
+
+            struct cell {
+                aabb                box {};
+                std::vector<member> members {};
+            };
+
+            struct location {
+                uint32_t cell { npos };
+                // next free proxy while cell is npos
+                uint32_t slot {};
+            };
+
+            std::unordered_map<uint64_t, uint32_t> cell_of {};
+            std::vector<cell>                      cells {};
+            std::vector<location>                  proxies {};
+            uint32_t                               free_list { npos };
+            size_t                                 count {};
+            float                                  cell_size {};
+
+            // how far any object ever reached out of its cell's center
+            // region, which widens the cells a region query looks up
+            float reach {};
+
+            static constexpr int64_t  key_bits = 21;
+            static constexpr uint64_t key_mask = (uint64_t(1) << key_bits) - 1;
+
+            int64_t coord(float v) const {
+                return static_cast<int64_t>(std::floor(v / cell_size));
+            }
+
+            // coordinates wrap around a million cells away from the origin,
+            // cells that far apart then share a key, which is only looser
+            static uint64_t key(int64_t x, int64_t y, int64_t z) {
+                return (uint64_t(x) & key_mask)
+                     | (uint64_t(y) & key_mask) << key_bits
+                     | (uint64_t(z) & key_mask) << 2 * key_bits;
+            }
+
+            template<typename Test, typename F>
+            static void visit_cell(const cell& c, Test& test, F& fn) {
+                if ( c.members.empty() || !test(c.box) ) return;
+
+                for ( const auto& m : c.members ) {
+                    if ( test(m.box) ) fn(m.value);
+                }
+            }
+
+            uint32_t find_cell(const glm::vec3& p);
+            void     place(uint32_t handle, const aabb& box, uint32_t value);
+            member   take(uint32_t handle);
+
+          public:
+            using proxy = uint32_t;
+
+            explicit grid(float cell_size = 8.f);
+
+            proxy insert(const aabb& box, uint32_t value);
+            void  remove(proxy p);
+
+            // Follows an object to `box`, returns false if it stayed in
+            // its cell
+            bool move(proxy p, const aabb& box);
+
+            void clear();
+
+            // Calls fn(value) for every object whose box passes test(aabb),
+            // test also prunes whole cells
+            template<typename Test, typename F>
+            void visit(Test&& test, F&& fn) const {
+                for ( const auto& c : cells ) {
+                    visit_cell(c, test, fn);
+                }
+            }
+
+            // Same, for a test that only passes boxes overlapping `region`
+            template<typename Test, typename F>
+            void visit(const aabb& region, Test&& test, F&& fn) const {
+                const glm::vec3 lo { region.min - glm::vec3 { reach } };
+                const glm::vec3 hi { region.max + glm::vec3 { reach } };
+
+                const int64_t x0 { coord(lo.x) }, x1 { coord(hi.x) };
+                const int64_t y0 { coord(lo.y) }, y1 { coord(hi.y) };
+                const int64_t z0 { coord(lo.z) }, z1 { coord(hi.z) };
+
+                // cheaper to go over the occupied cells then, this also
+                // keeps wrapped around keys from being visited twice
+                const double span { double(x1 - x0 + 1) * double(y1 - y0 + 1)
+                                    * double(z1 - z0 + 1) };
+                if ( span > double(cells.size()) ) {
+                    visit(test, fn);
+                    return;
+                }
+
+                for ( auto z { z0 }; z <= z1; ++z ) {
+                    for ( auto y { y0 }; y <= y1; ++y ) {
+                        for ( auto x { x0 }; x <= x1; ++x ) {
+                            const auto it { cell_of.find(key(x, y, z)) };
+                            if ( it != cell_of.end() ) {
+                                visit_cell(cells[it->second], test, fn);
+                            }
+                        }
+                    }
+                }
+            }
+
+            size_t size() const {
+                return count;
+            }
+        };
+
+    }  // namespace spatial
+
+    // How a spatial_index organizes its objects
+    enum class spatial_layout {
+        // ecs::spatial::bvh, adapts to any distribution of objects
+        bvh,
+        // ecs::spatial::grid, cheaper updates for many small moving objects
+        grid,
+    };
+
+    struct spatial_config {
+        spatial_layout layout { spatial_layout::bvh };
+        // how much further than its object a bvh leaf reaches
+        float margin { .1f };
+        // edge length of a grid cell
+        float cell_size { 8.f };
+    };
+
+    // World space boxes of every entity that has both a bounds and a
+    // world_transform, for frustum, box, sphere and ray queries.
+    //
+    // update() brings the index in line with the context, only touching the
+    // entities whose bounds or world_transform changed since the previous
+    // update, or that came or went. Run it after the transform_system.
+    // Queries append the matching entities to `out`, in no particular
+    // order, and are safe to run concurrently with each other
+    class spatial_index {
+      private:
+        using aabb = potato::math::aabb;
+
+        struct entry {
+            entity_id eid {};
+            aabb      box {};
+            uint32_t  proxy {};
+            uint32_t  pass {};
+        };
+
+        spatial_config config {};
+        spatial::bvh   tree;
+        spatial::grid  cells;
+
+        std::vector<entry> entries {};
+
+        // position in `entries` by entity index, spatial::npos if none
+        std::vector<uint32_t> slot_of {};
+
+        tick_t   last_seen {};
+        uint32_t pass {};
+
+        uint32_t find(entity_id eid) const;
+        void     insert(entity_id eid, const aabb& box);
+        void     erase(uint32_t pos);
+
+        // Calls fn(entry) for every entry whose box passes test(aabb). If
+        // given, test only passes boxes overlapping `region`
+        template<typename Test, typename F>
+        void visit(const std::optional<aabb>& region,
+                   Test&&                     test,
+                   F&&                        fn) const {
+            auto hit = [&](uint32_t index) {
+                const auto& e { entries[slot_of[index]] };
+                if ( test(e.box) ) fn(e);
+            };
+
+            if ( config.layout == spatial_layout::bvh ) {
+                tree.visit(test, hit);
+            }
+            else if ( region ) {
+                cells.visit(*region, test, hit);
+            }
+            else {
+                cells.visit(test, hit);
+            }
+        }
+
+      public:
+        explicit spatial_index(spatial_config = {});
+
+        void update(context&);
+        void clear();
+
+        void query(const potato::math::aabb&,
+                   std::vector<entity_id>& out) const;
+        void query(const potato::math::sphere&,
+                   std::vector<entity_id>& out) const;
+        void query(const potato::math::frustum&,
+                   std::vector<entity_id>& out) const;
+
+        // every entity the ray passes through before max_distance
+        void query(const potato::math::ray&,
+                   float                   max_distance,
+                   std::vector<entity_id>& out) const;
+
+        struct ray_hit {
+            entity_id eid {};
+            float     distance {};
+        };
+
+        // the first box the ray enters before max_distance
+        std::optional<ray_hit> raycast(const potato::math::ray&,
+                                       float max_distance) const;
+
+        // World space box of eid as of the last update, eid must be indexed
+        const aabb& box(entity_id eid) const;
+
+        bool contains(entity_id eid) const {
+            return find(eid) != spatial::npos;
+        }
+
+        size_t size() const {
+            return entries.size();
+        }
+    };
+
+}  // namespace ecs
+
+#endif
@@ -0,0 +1,213 @@
+#ifndef POTATO_ECS_TAG_HPP
+#define POTATO_ECS_TAG_HPP
+
+#include "component.hpp"
+#include "per_thread.hpp"
+#include "snapshot.hpp"
+#include "sparse_set.hpp"
+#include "utils.hpp"
+
+#include <atomic>
+#include <concepts>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace ecs {
+
+    // Store for empty components, which only mark their entities, as in
+    //
+    //   struct selected {};
+    //   ctx.add<selected>(eid);
+    //   for ( auto [eid, t] : ctx.view<transform, const selected>() ) ...
+    //   ctx.each<transform>(ecs::exclude<selected>, ...);
+    //
+    // Nothing is stored per entity besides its bit in the context's masks
+    // and its id in the sparse set, so a tag costs a few bytes per entity
+    // that has it, and filtering a view by it is one sparse set probe.
+    // Every entity shares the one T the store holds, get() hands out a
+    // reference to it so tags can be named in views like any component.
+    //
+    // Tags carry no data to change, they are never stamped and do not
+    // count towards a view's changed_since(). Groups cannot own them
+    template<component_type T>
+    class tag_components final : public icomponents {
+        static_assert(tag_component<T>,
+                      "Tag components must be empty and declare no fields");
+
+      public:
+        using type  = T;
+        using index = sparse_set::index;
+
+      private:
+        sparse_set entities {};
+
+        // what get() hands out, for every entity
+        T value {};
+
+        // ids added through add_concurrent, one list per thread. Boxed like
+        // components<T>::staged
+        std::unique_ptr<per_thread<std::vector<entity::id>>> staged {
+            std::make_unique<per_thread<std::vector<entity::id>>>()
+        };
+
+        entity_masks* masks {};
+        size_t        bit { type_id<T>() };
+
+      public:
+        explicit tag_components(entity_masks* masks = nullptr,
+                                const std::atomic<tick_t>* = nullptr)
+          : masks { masks } {}
+
+        // no copy
+        tag_components(const tag_components&) = delete;
+        tag_components& operator=(const tag_components&) = delete;
+
+        // allow move
+        tag_components(tag_components&&) = default;
+        tag_components& operator=(tag_components&&) = default;
+
+        // Any arguments are ignored, they are taken so that code written
+        // for components<T> works with tags as well
+        template<typename... Args>
+        T& add(entity::id eid, Args...) {
+            if ( contains(eid) ) {
+                throw std::logic_error("Entity already has component");
+            }
+
+            entities.insert(eid);
+            if ( masks ) masks->set(eid.index, bit);
+            return value;
+        }
+
+        void add_bulk(std::span<const entity::id> ids) {
+            entities.insert(ids);
+
+            if ( !masks ) return;
+            for ( auto eid : ids ) {
+                masks->set(eid.index, bit);
+            }
+        }
+
+        void add_bulk(std::span<const entity::id> ids, std::span<const T>) {
+            add_bulk(ids);
+        }
+
+        template<std::invocable<entity::id> F>
+        void add_bulk(std::span<const entity::id> ids, F&&) {
+            add_bulk(ids);
+        }
+
+        bool contains(entity::id eid) const {
+            return entities.contains(eid);
+        }
+
+        T& get(entity::id eid) {
+            if ( !contains(eid) ) {
+                throw std::out_of_range("Entity does not have component");
+            }
+            return value;
+        }
+
+        const T& get_const(entity::id eid) const {
+            if ( !contains(eid) ) {
+                throw std::out_of_range("Entity does not have component");
+            }
+            return value;
+        }
+
+        // Tags are never stamped
+        tick_t changed_at(entity::id) const {
+            return 0;
+        }
+
+        void touch(entity::id) {}
+
+        template<typename... Args>
+        void add_concurrent(entity::id eid, Args...) {
+            staged->local().push_back(eid);
+        }
+
+        void flush(const context& ctx) override {
+            staged->for_each([&](std::vector<entity::id>& ids) {
+                for ( auto eid : ids ) {
+                    if ( ctx.alive(eid) && !contains(eid) ) add(eid);
+                }
+                ids.clear();
+            });
+        }
+
+        void remove(entity::id eid) override {
+            if ( !contains(eid) ) return;
+
+            entities.erase(eid);
+            if ( masks ) masks->reset(eid.index, bit);
+        }
+
+        void remove_bulk(std::span<const entity::id> ids) override {
+            for ( auto eid : ids ) {
+                remove(eid);
+            }
+        }
+
+        void reserve(size_t n) {
+            entities.reserve(n);
+        }
+
+        void clear() override {
+            if ( masks ) {
+                for ( auto eid : ids() ) {
+                    masks->reset(eid.index, bit);
+                }
+            }
+            entities.clear();
+        }
+
+        uint64_t key() const override {
+            return type_key<T>();
+        }
+
+        // Only the ids are saved, a section without columns
+        void save(snapshot_writer& out) const override {
+            out.store(key(), ids(), 0);
+        }
+
+        void check_layout(const snapshot_section& in) const override {
+            in.expect_columns(0);
+        }
+
+        void load(const snapshot_section& in) override {
+            clear();
+            entities.insert(in.ids);
+
+            if ( !masks ) return;
+            for ( auto eid : in.ids ) {
+                masks->set(eid.index, bit);
+            }
+        }
+
+        size_t size() const {
+            return entities.size();
+        }
+
+        bool empty() const {
+            return entities.empty();
+        }
+
+        std::span<const entity::id> ids() const {
+            return entities.entities();
+        }
+
+        auto begin() const {
+            return entities.begin();
+        }
+
+        auto end() const {
+            return entities.end();
+        }
+    };
+
+}  // namespace ecs
+
+#endif
@@ -0,0 +1,197 @@
+#include "transform.hpp"
+
+#include "component.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+namespace ecs {
+
+    transform_system::transform_system(potato::jobs::pool& p)
+      : workers { p } {}
+
+    uint32_t transform_system::find(entity_id eid) const {
+        if ( eid.index >= slot_of.size() ) return npos;
+
+        const auto pos { slot_of[eid.index] };
+        return pos != npos && order[pos].eid == eid ? pos : npos;
+    }
+
+    void transform_system::rebuild(context& ctx) {
+        auto& transforms { ctx.get_component<transform>() };
+        auto& world { ctx.get_component<world_transform>() };
+        auto  links { ctx.find_component<hierarchy>() };
+
+        // every entity with both components, in store order for now
+        std::vector<entity_id> nodes {};
+        uint32_t               highest {};
+
+        for ( auto eid : world.ids() ) {
+            if ( transforms.contains(eid) ) {
+                nodes.push_back(eid);
+                highest = std::max(highest, eid.index);
+            }
+        }
+
+        // find() works on `nodes` positions while the order is built
+        order.assign(nodes.size(), {});
+        slot_of.assign(nodes.empty() ? 0 : size_t(highest) + 1, npos);
+
+        for ( uint32_t i = 0; i < nodes.size(); ++i ) {
+            order[i].eid             = nodes[i];
+            slot_of[nodes[i].index] = i;
+        }
+
+        std::vector<uint32_t> parent_of(nodes.size(), npos);
+
+        if ( links ) {
+            for ( uint32_t i = 0; i < nodes.size(); ++i ) {
+                if ( links->contains(nodes[i]) ) {
+                    parent_of[i] = find(links->get_const(nodes[i]).parent);
+                }
+            }
+        }
+
+        // children of node i are children[first_child[i], first_child[i+1])
+        std::vector<uint32_t> first_child(nodes.size() + 1, 0);
+        for ( auto p : parent_of ) {
+            if ( p != npos ) ++first_child[p + 1];
+        }
+        std::partial_sum(first_child.begin(),
+                         first_child.end(),
+                         first_child.begin());
+
+        std::vector<uint32_t> children(nodes.size());
+        std::vector<uint32_t> fill(first_child.begin(), first_child.end() - 1);
+        for ( uint32_t i = 0; i < nodes.size(); ++i ) {
+            if ( parent_of[i] != npos ) children[fill[parent_of[i]]++] = i;
+        }
+
+        // position of each node in the new order
+        std::vector<uint32_t> placed(nodes.size(), npos);
+        std::vector<uint32_t> stack {};
+
+        order.clear();
+        branches.clear();
+
+        auto walk = [&](uint32_t root) {
+            const auto begin { static_cast<uint32_t>(order.size()) };
+
+            stack.push_back(root);
+            while ( !stack.empty() ) {
+                const auto i { stack.back() };
+                stack.pop_back();
+
+                // only happens when coming back around a cycle
+                if ( placed[i] != npos ) continue;
+
+                placed[i] = static_cast<uint32_t>(order.size());
+                order.push_back({
+                  .eid    = nodes[i],
+                  .parent = i == root ? npos : placed[parent_of[i]],
+                });
+
+                // reversed, so children come out in store order
+                for ( auto c { first_child[i + 1] }; c > first_child[i]; --c ) {
+                    stack.push_back(children[c - 1]);
+                }
+            }
+
+            branches.push_back({ begin, static_cast<uint32_t>(order.size()) });
+        };
+
+        for ( uint32_t i = 0; i < nodes.size(); ++i ) {
+            if ( parent_of[i] == npos ) walk(i);
+        }
+
+        // whatever is left hangs off a parent cycle
+        for ( uint32_t i = 0; i < nodes.size(); ++i ) {
+            if ( placed[i] == npos ) walk(i);
+        }
+
+        for ( uint32_t pos = 0; pos < order.size(); ++pos ) {
+            slot_of[order[pos].eid.index] = pos;
+        }
+
+        worlds.resize(order.size());
+        dirty.assign(order.size(), 1);
+
+        transforms_seen = transforms.layout_revision();
+        worlds_seen     = world.layout_revision();
+        links_seen      = links ? links->layout_revision() : 0;
+    }
+
+    void transform_system::propagate(const components<transform>& transforms,
+                                     components<world_transform>&  world,
+                                     const branch&                 b) {
+        for ( auto i { b.begin }; i < b.end; ++i ) {
+            const auto& n { order[i] };
+
+            // parents come first, their flag is final by now
+            if ( n.parent != npos && dirty[n.parent] ) dirty[i] = 1;
+            if ( !dirty[i] ) continue;
+
+            // the order is rebuilt whenever either store changes shape, this
+            // only guards against writing through a stale order
+            const auto t { transforms.find(n.eid) };
+            const auto w { world.find(n.eid) };
+            if ( t == sparse_set::npos || w == sparse_set::npos ) continue;
+
+            const auto local { transforms[t].mat4() };
+
+            worlds[i] = n.parent == npos ? local : worlds[n.parent] * local;
+            world.get_at(w).matrix = worlds[i];
+        }
+    }
+
+    void transform_system::run(context& ctx) {
+        auto transforms { ctx.find_component<transform>() };
+        auto world { ctx.find_component<world_transform>() };
+        auto links { ctx.find_component<hierarchy>() };
+
+        if ( !transforms || !world ) return;
+
+        const auto since { std::exchange(last_seen, ctx.advance_tick()) };
+
+        // components were added or removed, or links changed
+        bool stale { transforms->layout_revision() != transforms_seen
+                     || world->layout_revision() != worlds_seen
+                     || (links ? links->layout_revision() : 0) != links_seen };
+
+        if ( !stale && links ) {
+            stale = std::ranges::any_of(links->changes(),
+                                        [&](tick_t t) { return t > since; });
+        }
+
+        if ( !stale ) {
+            std::ranges::fill(dirty, 0);
+
+            const auto ids { transforms->ids() };
+            const auto stamps { transforms->changes() };
+
+            for ( size_t k = 0; k < ids.size(); ++k ) {
+                if ( stamps[k] <= since ) continue;
+
+                if ( auto pos { find(ids[k]) }; pos != npos ) {
+                    dirty[pos] = 1;
+                }
+                else if ( world->contains(ids[k]) ) {
+                    // an entity replaced another one since the last run
+                    stale = true;
+                    break;
+                }
+            }
+        }
+
+        if ( stale ) rebuild(ctx);
+
+        potato::jobs::parallel_for(
+          0,
+          branches.size(),
+          [&](size_t b) { propagate(*transforms, *world, branches[b]); },
+          0,
+          workers);
+    }
+
+}  // namespace ecs
@@ -0,0 +1,118 @@
+#ifndef POTATO_ECS_TRANSFORM_HPP
+#define POTATO_ECS_TRANSFORM_HPP
+
+#include "context.hpp"
+#include "core/jobs.hpp"
+#include "core/trs.hpp"
+#include "utils.hpp"
+
+#include <limits>
+#include <vector>
+
+// Translation, rotation and scale of an entity. Relative to its parent if
+// it has a hierarchy component, otherwise to the world
+struct transform {
+    glm::vec3 translation {};
+    glm::vec3 scale { 1.0f };
+    glm::quat rotation {};
+
+    void euler_rotate(glm::vec3 euler_angles) {
+        rotation = potato::math::euler_to_quat(euler_angles);
+    }
+
+    glm::mat4 mat4() const {
+        return potato::math::trs_to_mat4(translation, rotation, scale);
+    }
+};
+
+// Local-to-world matrix of an entity, kept up to date by
+// ecs::transform_system. Read it instead of calling transform::mat4()
+struct world_transform {
+    glm::mat4 matrix { 1.f };
+};
+
+// Parents an entity's transform to another entity. Entities without one,
+// or whose parent has no transform, are roots
+struct hierarchy {
+    ecs::entity_id parent {};
+};
+
+namespace ecs {
+
+    // Computes world_transform for every entity that has both a transform
+    // and a world_transform.
+    //
+    // The hierarchy is flattened into depth-first order, parents before
+    // their children, with each root's subtree in one contiguous branch.
+    // That order is only rebuilt when hierarchy links or the set of entities
+    // change. Each run recomputes only the entities whose transform changed
+    // since the previous run, plus everything below them. Branches do not
+    // share any node, so they are processed in parallel.
+    //
+    // Parent cycles are broken at an arbitrary node, which becomes a root.
+    class transform_system {
+      private:
+        static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+        struct node {
+            entity_id eid {};
+            // position of the parent in `order`, npos for roots
+            uint32_t parent { npos };
+        };
+
+        // [begin, end) range of `order` covering one root's subtree
+        struct branch {
+            uint32_t begin {};
+            uint32_t end {};
+        };
+
+        std::vector<node>   order {};
+        std::vector<branch> branches {};
+
+        // position in `order` by entity index, npos if not a node
+        std::vector<uint32_t> slot_of {};
+
+        // per node of `order`, world matrices are kept between runs so that
+        // clean parents need not be read back from the store
+        std::vector<glm::mat4> worlds {};
+        std::vector<uint8_t>   dirty {};
+
+        // layout revisions of the stores the current order was built from.
+        // Any add or remove bumps them, even when the sizes stay the same
+        uint64_t transforms_seen { std::numeric_limits<uint64_t>::max() };
+        uint64_t worlds_seen {};
+        uint64_t links_seen {};
+
+        tick_t last_seen {};
+
+        potato::jobs::pool& workers;
+
+        uint32_t find(entity_id eid) const;
+
+        void rebuild(context&);
+        void propagate(const components<transform>&,
+                       components<world_transform>&,
+                       const branch&);
+
+      public:
+        explicit transform_system(potato::jobs::pool& =
+                                    potato::jobs::pool::shared());
+
+        // no copy, no move, running jobs hold on to it
+        transform_system(const transform_system&) = delete;
+        transform_system& operator=(const transform_system&) = delete;
+
+        // Brings every world_transform up to date. Must not run at the same
+        // time as anything that writes transform or hierarchy components, or
+        // adds and removes entities
+        void run(context&);
+
+        // number of entities with a world transform, as of the last run
+        size_t size() const {
+            return order.size();
+        }
+    };
+
+}  // namespace ecs
+
+#endif
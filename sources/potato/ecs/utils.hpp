@@ -1,34 +1,249 @@
 #ifndef POTATO_ECS_UTILS_HPP
 #define POTATO_ECS_UTILS_HPP
 
+#include "signature.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <concepts>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
 
 namespace ecs {
     // clang-format off
-    template<uint64_t a>
-    concept power_of_2 = std::same_as<
-        std::integral_constant<bool, (a & a - 1) == 0 && (a != 0)>,
-        std::true_type
-    >;
+    template<typename T>
+    concept component_type =
+      std::is_object_v<T> && std::same_as<T, std::remove_cv_t<T>> &&
+      std::move_constructible<T>;
+
+    // A component as named in a query, `const T` asks for read-only access
+    template<typename T>
+    concept component_access = component_type<std::remove_const_t<T>>;
+
+    // Field list a component declares as `using fields = ecs::fields<...>`
+    // to be stored as structure-of-arrays, see ecs::soa_components
+    template<auto... Members>
+    struct fields {};
 
     template<typename T>
-    concept component_type = power_of_2<T::signature>;
+    concept soa_component =
+      component_type<T> && std::default_initializable<T> && requires {
+        typename T::fields;
+    };
+
+    // Empty components only say something about their entity, as in
+    // `struct selected {};`, and live in a store without items, see
+    // ecs::tag_components
+    template<typename T>
+    concept tag_component =
+      component_type<T> && std::is_empty_v<T> && !soa_component<T>;
 
     template <typename T>
     concept component_store =
-      std::is_member_function_pointer<decltype(&T::add)> &&
-      std::is_member_function_pointer<decltype(&T::remove)>;
+      std::is_member_function_pointer_v<decltype(&T::add)> &&
+      std::is_member_function_pointer_v<decltype(&T::remove)>;
     // clang-format on
 
+    // Generational handle to an entity, handed out by ecs::context. Indices
+    // are reused once their entity is destroyed, the generation tells the
+    // old and new owners of an index apart. A default constructed handle
+    // refers to no entity.
+    struct entity_id {
+        uint32_t index {};
+        uint32_t generation {};
+
+        constexpr bool operator==(const entity_id&) const = default;
+
+        explicit constexpr operator bool() const {
+            return generation != 0;
+        }
+    };
+
+    // Value of a context's change clock, see context::advance_tick
+    using tick_t = uint64_t;
+
+    namespace internal {
+        inline std::atomic<size_t> next_type_id { 0 };
+
+        // the compiler's spelling of this function, which names T
+        template<typename T>
+        constexpr std::string_view type_signature() {
+#ifdef _MSC_VER
+            return __FUNCSIG__;
+#else
+            return __PRETTY_FUNCTION__;
+#endif
+        }
+
+        constexpr uint64_t fnv1a(std::string_view s) {
+            uint64_t hash { 0xcbf29ce484222325 };
+            for ( auto c : s ) {
+                hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3;
+            }
+            return hash;
+        }
+
+        template<auto A, auto B>
+        constexpr bool same_member() {
+            if constexpr ( std::is_same_v<decltype(A), decltype(B)> ) {
+                return A == B;
+            }
+            else {
+                return false;
+            }
+        }
+
+        // position of member M in the field list
+        template<auto M, auto... Ms>
+        constexpr size_t field_index(fields<Ms...>) {
+            size_t i {};
+            size_t found { sizeof...(Ms) };
+            ((same_member<M, Ms>() ? found = i++ : i++), ...);
+            return found;
+        }
+
+        template<typename T, typename F>
+        F member_type_of(F T::*);
+
+        template<typename T, typename F>
+        T class_type_of(F T::*);
+
+        template<auto M>
+        using member_t = decltype(member_type_of(M));
+
+        template<auto M>
+        using class_t = decltype(class_type_of(M));
+
+        // converts to anything, so T { any_field {}... } counts the members
+        // of an aggregate T
+        struct any_field {
+            template<typename U>
+            operator U() const;
+        };
+
+        template<typename T, typename... Fs>
+        constexpr size_t aggregate_arity() {
+            if constexpr ( requires { T { Fs {}..., any_field {} }; } ) {
+                return aggregate_arity<T, Fs..., any_field>();
+            }
+            else {
+                return sizeof...(Fs);
+            }
+        }
+
+        // room the fields take at most, each padded to alignof(T)
+        template<typename T, auto M>
+        constexpr size_t padded_size() {
+            return (sizeof(member_t<M>) + alignof(T) - 1) / alignof(T)
+                 * alignof(T);
+        }
+
+        // Whether the field list can account for all of T. An aggregate
+        // must list every member, anything else must at least be no larger
+        // than its fields
+        template<typename T, auto... Ms>
+        constexpr bool declares_all(fields<Ms...>) {
+            if ( sizeof(T) > (padded_size<T, Ms>() + ... + 0) ) {
+                return false;
+            }
+
+            if constexpr ( std::is_aggregate_v<T> ) {
+                return aggregate_arity<T>() == sizeof...(Ms);
+            }
+            else {
+                return true;
+            }
+        }
+    }  // namespace internal
+
+    // Dense id of a component type, handed out the first time the type is
+    // asked for. Ids start at 0 with no gaps, so they index flat arrays of
+    // stores directly, and double as the type's bit in a signature. They are
+    // only stable for the life of the process, never persist them.
+    template<component_type T>
+    size_t type_id() {
+        static const size_t id { internal::next_type_id.fetch_add(1) };
+        return id;
+    }
+
+    // Hash of T's name. Unlike type_id() it is the same in every run of
+    // every build made by the same compiler, snapshots key stores by it
+    template<component_type T>
+    constexpr uint64_t type_key() {
+        return internal::fnv1a(internal::type_signature<T>());
+    }
+
+    // Paging of a components<T> store, see ecs::paged_vector. A component
+    // picks its own by declaring `static constexpr size_t page_size`, in
+    // components and a power of two, and `static constexpr bool
+    // huge_pages`. Types that cannot be changed specialize the traits
+    // instead. By default a page holds as many components as fit in 16 KiB
+    template<component_type T>
+    struct page_traits {
+        static constexpr size_t size { [] {
+            if constexpr ( requires { T::page_size; } ) {
+                return size_t { T::page_size };
+            }
+            else {
+                return std::bit_floor(
+                  std::max(size_t { 16384 } / sizeof(T), size_t { 1 }));
+            }
+        }() };
+
+        static constexpr bool huge { [] {
+            if constexpr ( requires { T::huge_pages; } ) {
+                return bool { T::huge_pages };
+            }
+            else {
+                return false;
+            }
+        }() };
+    };
+
+    // Tag for the components an iteration should skip, as in
+    // ctx.view<transform>(ecs::exclude<hidden>)
+    template<typename... Xs>
+    struct exclude_t {};
+
+    template<typename... Xs>
+    inline constexpr exclude_t<Xs...> exclude {};
+
     // forward declares just cause
 
     class entity;
     class context;
     class icomponents;
+    class igroup;
+    class snapshot;
+    class snapshot_writer;
+    struct snapshot_section;
 
     template<component_type T>
     class components;
 
+    template<component_type T>
+    class soa_components;
+
+    template<component_type T>
+    class tag_components;
+
+    // Store type a context uses for T
+    template<component_type T>
+    using store_for = std::conditional_t<
+      soa_component<T>,
+      soa_components<T>,
+      std::conditional_t<tag_component<T>, tag_components<T>, components<T>>>;
+
+    template<typename Exclude, component_access... Ts>
+    class basic_view;
+
+    template<component_type... Ts>
+    requires(sizeof...(Ts) >= 2
+             && (!soa_component<Ts> && ...) && (!tag_component<Ts> && ...))
+    class group;
+
 }  // namespace ecs
 
 #endif
@@ -0,0 +1,227 @@
+#ifndef POTATO_ECS_VIEW_HPP
+#define POTATO_ECS_VIEW_HPP
+
+#include "component.hpp"
+#include "core/jobs.hpp"
+#include "soa.hpp"
+#include "tag.hpp"
+#include "utils.hpp"
+
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace ecs {
+
+    // Iterable range over the entities of a context that have all the
+    // components Ts and none of the excluded components Xs. Dereferencing
+    // yields a std::tuple<entity_id, Ts&...>. Components named as `const T`
+    // are only read, the others are stamped as changed when dereferenced,
+    // unless the view was narrowed by changed_since(), which only reads.
+    // Structure-of-arrays components come as store proxies instead of
+    // references, see ecs::soa_components.
+    //
+    // Iteration is driven by the smallest of the included stores. Every other
+    // store is only probed through its sparse set, so skipping entities that
+    // do not match never hashes. Dereferencing builds the tuple on the fly
+    // and returns it by value, so iterators only model std::forward_iterator
+    // in the C++20 sense. To the classic algorithms they are input
+    // iterators, which the parallel ones do not take. par_each() spreads
+    // the entities over a job pool instead.
+    template<component_type... Xs, component_access... Ts>
+    class basic_view<exclude_t<Xs...>, Ts...> {
+        static_assert(sizeof...(Ts) > 0, "View needs at least one component");
+
+      private:
+        template<typename E, component_access... Us>
+        friend class basic_view;
+
+        template<typename T>
+        using store = store_for<std::remove_const_t<T>>;
+
+        // what fetch() hands out for T, a reference or a store proxy
+        template<typename T>
+        using access = std::conditional_t<
+          std::is_const_v<T>,
+          decltype(std::declval<const store<T>&>().get_const(entity_id {})),
+          decltype(std::declval<store<T>&>().get(entity_id {}))>;
+
+        std::tuple<store<Ts>*...>     included {};
+        std::tuple<store_for<Xs>*...> excluded {};
+        std::span<const entity_id>    driver {};
+
+        // only entities with a component changed after this tick match.
+        // Stamps start at 1, so 0 lets everything through
+        tick_t since {};
+
+        template<typename T>
+        access<T> fetch(entity_id eid) const {
+            if constexpr ( std::is_const_v<T> ) {
+                return std::get<store<T>*>(included)->get_const(eid);
+            }
+            else {
+                return std::get<store<T>*>(included)->get(eid);
+            }
+        }
+
+        bool accepts(entity_id eid) const {
+            return (std::get<store<Ts>*>(included)->contains(eid) && ...)
+                && !((std::get<store_for<Xs>*>(excluded)
+                      && std::get<store_for<Xs>*>(excluded)->contains(eid))
+                     || ...)
+                && (since == 0
+                    || ((std::get<store<Ts>*>(included)->changed_at(eid)
+                         > since)
+                        || ...));
+        }
+
+      public:
+        using value_type = std::tuple<entity_id, access<Ts>...>;
+
+        class iterator {
+          private:
+            const basic_view* view {};
+            size_t            pos {};
+
+            void skip() {
+                while ( pos < view->driver.size()
+                        && !view->accepts(view->driver[pos]) )
+                {
+                    ++pos;
+                }
+            }
+
+          public:
+            using value_type        = basic_view::value_type;
+            using reference         = value_type;
+            using difference_type   = std::ptrdiff_t;
+            using iterator_category = std::input_iterator_tag;
+            using iterator_concept  = std::forward_iterator_tag;
+
+            iterator() = default;
+
+            iterator(const basic_view* v, size_t position)
+              : view { v }
+              , pos { position } {
+                skip();
+            }
+
+            reference operator*() const {
+                const auto eid { view->driver[pos] };
+                return { eid, view->template fetch<Ts>(eid)... };
+            }
+
+            iterator& operator++() {
+                ++pos;
+                skip();
+                return *this;
+            }
+
+            iterator operator++(int) {
+                auto old { *this };
+                ++*this;
+                return old;
+            }
+
+            bool operator==(const iterator& other) const {
+                return pos == other.pos;
+            }
+        };
+
+        basic_view() = default;
+
+        // A null included store means the component was never registered,
+        // so nothing can match. A null excluded store excludes nothing.
+        basic_view(std::tuple<store<Ts>*...>     inc,
+                   std::tuple<store_for<Xs>*...> exc)
+          : included { inc }
+          , excluded { exc } {
+
+            const bool all_present {
+                ((std::get<store<Ts>*>(included) != nullptr) && ...)
+            };
+
+            if ( !all_present ) return;
+
+            // drive the iteration from the smallest store
+            std::apply(
+              [this](auto*... stores) {
+                  driver = std::get<0>(included)->ids();
+                  ((driver = stores->size() < driver.size() ? stores->ids()
+                                                            : driver),
+                   ...);
+              },
+              included);
+        }
+
+        iterator begin() const {
+            return { this, 0 };
+        }
+
+        iterator end() const {
+            return { this, driver.size() };
+        }
+
+        // Upper bound on the number of entities the view yields
+        size_t size_hint() const {
+            return driver.size();
+        }
+
+        // Same view, narrowed to entities where at least one of Ts changed
+        // after `tick`, see context::advance_tick. Every component comes as
+        // const, reading them must not count as a change, or whatever the
+        // view went through would match again on the next run
+        basic_view<exclude_t<Xs...>, const Ts...>
+        changed_since(tick_t tick) const {
+            basic_view<exclude_t<Xs...>, const Ts...> narrowed {};
+            narrowed.included = included;
+            narrowed.excluded = excluded;
+            narrowed.driver   = driver;
+            narrowed.since    = tick;
+            return narrowed;
+        }
+
+        // Calls fn(entity_id, Ts&...) for every matching entity
+        template<typename F>
+        void each(F&& fn) const {
+            for ( auto eid : driver ) {
+                if ( accepts(eid) ) {
+                    fn(eid, fetch<Ts>(eid)...);
+                }
+            }
+        }
+
+        // Like each(), with the entities split into chunks of `grain` that
+        // run on `workers`, see potato::jobs::parallel_for. fn is called
+        // from several threads at once, once per entity. It must not add or
+        // remove components of Ts, stage those through add_concurrent() or
+        // a command buffer. Returns once every entity was visited, and
+        // rethrows the first exception fn threw
+        template<typename F>
+        void par_each(
+          F&&                 fn,
+          size_t              grain   = 0,
+          potato::jobs::pool& workers = potato::jobs::pool::shared()) const {
+            potato::jobs::parallel_for(
+              0,
+              driver.size(),
+              [&](size_t i) {
+                  const auto eid { driver[i] };
+                  if ( accepts(eid) ) {
+                      fn(eid, fetch<Ts>(eid)...);
+                  }
+              },
+              grain,
+              workers);
+        }
+    };
+
+    template<component_access... Ts>
+    using view = basic_view<exclude_t<>, Ts...>;
+
+}  // namespace ecs
+
+#endif
@@ -0,0 +1,238 @@
+#include "buddy.hpp"
+
+#include "../utils.hpp"
+#include "core/units.hpp"
+#include "graphics/utils/debug_name.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <stdexcept>
+
+namespace vma {
+
+    std::array<buddy_allocator::heap, VK_MAX_MEMORY_TYPES>
+      buddy_allocator::heaps {};
+
+    void buddy_allocator::arena::push(uint32_t unit, uint32_t order) {
+        auto& head { free_lists[order] };
+
+        next_free[unit] = head;
+        prev_free[unit] = no_block;
+        if ( head != no_block ) prev_free[head] = unit;
+        head = unit;
+
+        is_free[unit]    = true;
+        free_order[unit] = static_cast<uint8_t>(order);
+        free_mask |= 1u << order;
+        free_bytes += min_block << order;
+    }
+
+    void buddy_allocator::arena::erase(uint32_t unit) {
+        const uint32_t order { free_order[unit] };
+        auto&          head { free_lists[order] };
+
+        if ( prev_free[unit] != no_block ) {
+            next_free[prev_free[unit]] = next_free[unit];
+        }
+        if ( next_free[unit] != no_block ) {
+            prev_free[next_free[unit]] = prev_free[unit];
+        }
+        if ( head == unit ) head = next_free[unit];
+
+        if ( head == no_block ) free_mask &= ~(1u << order);
+
+        is_free[unit] = false;
+        free_bytes -= min_block << order;
+    }
+
+    uint32_t buddy_allocator::arena::take(uint32_t order) {
+        if ( order >= orders ) return no_block;
+
+        const auto larger { free_mask & (~0u << order) };
+        if ( larger == 0 ) return no_block;
+
+        auto       k { uint32_t(std::countr_zero(larger)) };
+        const auto unit { free_lists[k] };
+        erase(unit);
+
+        // keep the front half, the back halves go back as free blocks
+        while ( k > order ) {
+            --k;
+            push(unit + (1u << k), k);
+        }
+
+        return unit;
+    }
+
+    void buddy_allocator::arena::give_back(uint32_t unit, uint32_t order) {
+        while ( order + 1 < orders ) {
+            const auto buddy { unit ^ (1u << order) };
+            if ( !is_free[buddy] || free_order[buddy] != order ) break;
+
+            erase(buddy);
+            unit = std::min(unit, buddy);
+            ++order;
+        }
+
+        push(unit, order);
+    }
+
+    buddy_allocator::arena&
+    buddy_allocator::add_arena(heap& h, uint32_t mem_inx, uint32_t order) {
+        using namespace units::literals;
+
+        // twice the size of the previous pool, or more if that is too small
+        vk::DeviceSize capacity {
+            h.arenas.empty() ? 16_mb : h.arenas.back().pool.capacity * 2
+        };
+        while ( capacity < min_block << order ) {
+            capacity *= 2;
+        }
+
+        const auto units { static_cast<uint32_t>(capacity / min_block) };
+
+        auto& a { h.arenas.emplace_back() };
+        a.pool   = internal::pool(capacity, mem_inx);
+        a.orders = uint32_t(std::bit_width(units));
+
+        a.free_lists.assign(a.orders, no_block);
+        a.next_free.resize(units);
+        a.prev_free.resize(units);
+        a.free_order.resize(units);
+        a.is_free.resize(units);
+
+        a.push(0, a.orders - 1);
+
+        // clang-format off
+        potato::graphics::set_debug_name(
+          a.pool.memory,
+          internal::device,
+          std::format("Buddy pool [mem_inx {} pool_inx {}]", mem_inx, h.arenas.size() - 1));
+        // clang-format on
+
+        return a;
+    }
+
+    buddy_allocator::suballoc_t*
+    buddy_allocator::allocate(const vk::MemoryRequirements&  mem_req,
+                              const vk::MemoryPropertyFlags& mem_flags) {
+        const auto mem_inx {
+            find_mem_type(mem_flags, mem_req.memoryTypeBits)
+        };
+        auto& h { heaps[mem_inx] };
+
+        // blocks are aligned to their size, so a large enough block is
+        // also aligned enough
+        const auto wanted { std::max(mem_req.size, mem_req.alignment) };
+        const auto units {
+            std::max<vk::DeviceSize>((wanted + min_block - 1) / min_block, 1)
+        };
+        const auto order { uint32_t(std::bit_width(units - 1)) };
+
+        uint32_t arena_inx {};
+        uint32_t unit { no_block };
+        for ( ; arena_inx < h.arenas.size(); ++arena_inx ) {
+            unit = h.arenas[arena_inx].take(order);
+            if ( unit != no_block ) break;
+        }
+
+        if ( unit == no_block ) {
+            unit = add_arena(h, mem_inx, order).take(order);
+        }
+        if ( unit == no_block ) throw std::runtime_error("Allocation failed\n");
+
+        suballoc* sub {};
+        if ( h.spare.empty() ) {
+            sub = &h.blocks.emplace_back();
+        }
+        else {
+            sub = h.spare.back();
+            h.spare.pop_back();
+        }
+
+        *sub = suballoc {
+            .pool    = &h.arenas[arena_inx].pool,
+            .offset  = unit * min_block,
+            .size    = mem_req.size,
+            .order   = order,
+            .mem_inx = mem_inx,
+            .arena   = arena_inx,
+        };
+
+        ++h.allocations;
+        h.used += min_block << order;
+        h.requested += mem_req.size;
+
+        return sub;
+    }
+
+    void buddy_allocator::free(suballoc_t* sub) {
+        auto& h { heaps[sub->mem_inx] };
+
+        h.arenas[sub->arena].give_back(
+          static_cast<uint32_t>(sub->offset / min_block), sub->order);
+
+        --h.allocations;
+        h.used -= min_block << sub->order;
+        h.requested -= sub->size;
+
+        h.spare.push_back(sub);
+    }
+
+    vk::DeviceMemory buddy_allocator::suballoc::memory() const {
+        return pool->memory;
+    }
+
+    buddy_stats buddy_allocator::stats(uint32_t mem_inx) {
+        const auto& h { heaps[mem_inx] };
+
+        buddy_stats s {
+            .pools       = h.arenas.size(),
+            .allocations = h.allocations,
+            .used        = h.used,
+            .requested   = h.requested,
+        };
+
+        for ( const auto& a : h.arenas ) {
+            s.capacity += a.pool.capacity;
+            s.free += a.free_bytes;
+
+            if ( a.free_mask != 0 ) {
+                const auto largest { uint32_t(std::bit_width(a.free_mask)) };
+                s.largest_free =
+                  std::max(s.largest_free, min_block << (largest - 1));
+            }
+        }
+
+        return s;
+    }
+
+    buddy_stats buddy_allocator::stats() {
+        buddy_stats total {};
+
+        for ( uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; ++i ) {
+            const auto s { stats(i) };
+
+            total.pools += s.pools;
+            total.allocations += s.allocations;
+            total.capacity += s.capacity;
+            total.used += s.used;
+            total.requested += s.requested;
+            total.free += s.free;
+            total.largest_free = std::max(total.largest_free, s.largest_free);
+        }
+
+        return total;
+    }
+
+    void buddy_allocator::_free_pool() {
+        for ( auto& h : heaps ) {
+            for ( auto& a : h.arenas ) {
+                internal::device.free(a.pool.memory);
+            }
+            h = {};
+        }
+    }
+
+}  // namespace vma
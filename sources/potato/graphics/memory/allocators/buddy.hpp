@@ -0,0 +1,127 @@
+#ifndef POTATO_GRAPHICS_MEMORY_ALLOCATOR_BUDDY_HPP
+#define POTATO_GRAPHICS_MEMORY_ALLOCATOR_BUDDY_HPP
+
+#include "../internal.hpp"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace vma {
+
+    // Occupancy of the pools of a buddy_allocator
+    struct buddy_stats {
+        size_t         pools {};
+        size_t         allocations {};
+        vk::DeviceSize capacity {};
+        // size of the blocks handed out, and what was asked for in them
+        vk::DeviceSize used {};
+        vk::DeviceSize requested {};
+        // sum of the free blocks, and the largest of them
+        vk::DeviceSize free {};
+        vk::DeviceSize largest_free {};
+
+        // share of the used blocks lost to rounding up to a power of two
+        double internal_fragmentation() const {
+            return used ? 1. - double(requested) / double(used) : 0.;
+        }
+
+        // share of the free memory not in the largest free block, 0 when
+        // everything free could be handed out at once
+        double external_fragmentation() const {
+            return free ? 1. - double(largest_free) / double(free) : 0.;
+        }
+    };
+
+    // Buddy allocator. Pools are a power of two large and are handed out
+    // in blocks of min_block times a power of two, each aligned to its own
+    // size. Allocating splits a larger free block in halves until one fits,
+    // freeing merges a block with its buddy, its other half, for as long as
+    // that is free, both in O(log n) of the pool size. Suits resources of
+    // power of two sizes, like render targets and their mips, better than
+    // many small odd sized buffers, which lose up to half of their block.
+    //
+    // Pick it per resource through vma::memory<vma::buddy_allocator>.
+    class buddy_allocator {
+      public:
+        struct suballoc {
+            internal::pool* pool {};
+            vk::DeviceSize  offset {};
+            vk::DeviceSize  size {};
+
+            // the block holding it is min_block << order bytes
+            uint32_t order {};
+            uint32_t mem_inx {};
+            uint32_t arena {};
+
+            vk::DeviceMemory memory() const;
+        };
+
+      private:
+        static constexpr vk::DeviceSize min_block = 4096;
+
+        static constexpr uint32_t no_block = ~0u;
+
+        // one pool and its free blocks. Blocks are numbered by their offset
+        // in min_block units, the per-unit arrays describe the free block
+        // starting at that unit, if any
+        struct arena {
+            internal::pool pool {};
+            uint32_t       orders {};
+
+            // bit k set if free_lists[k] holds anything
+            uint32_t              free_mask {};
+            std::vector<uint32_t> free_lists {};
+
+            std::vector<uint32_t> next_free {};
+            std::vector<uint32_t> prev_free {};
+            std::vector<uint8_t>  free_order {};
+            std::vector<bool>     is_free {};
+
+            vk::DeviceSize free_bytes {};
+
+            void push(uint32_t unit, uint32_t order);
+            void erase(uint32_t unit);
+
+            // a free block of `order` cut out of the smallest free block
+            // that is large enough, no_block if there is none
+            uint32_t take(uint32_t order);
+
+            // frees the block at unit, merged with its free buddies
+            void give_back(uint32_t unit, uint32_t order);
+        };
+
+        struct heap {
+            std::deque<arena>      arenas {};
+            std::deque<suballoc>   blocks {};
+            std::vector<suballoc*> spare {};
+
+            size_t         allocations {};
+            vk::DeviceSize used {};
+            vk::DeviceSize requested {};
+        };
+
+        static std::array<heap, VK_MAX_MEMORY_TYPES> heaps;
+
+        static arena& add_arena(heap&, uint32_t mem_inx, uint32_t order);
+
+      public:
+        using suballoc_t = suballoc;
+
+        static void _free_pool();
+
+        // occupancy of one memory type, or of all of them
+        static buddy_stats stats(uint32_t mem_inx);
+        static buddy_stats stats();
+
+        buddy_allocator() = default;
+
+        [[nodiscard]] suballoc_t* allocate(const vk::MemoryRequirements&,
+                                           const vk::MemoryPropertyFlags&);
+        void                      free(suballoc_t*);
+    };
+
+}  // namespace vma
+
+#endif
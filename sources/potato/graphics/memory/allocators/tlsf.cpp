@@ -0,0 +1,222 @@
+#include "tlsf.hpp"
+
+#include "../utils.hpp"
+#include "core/units.hpp"
+#include "graphics/utils/debug_name.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <stdexcept>
+
+namespace vma {
+
+    std::array<tlsf_allocator::heap, VK_MAX_MEMORY_TYPES>
+      tlsf_allocator::heaps {};
+
+    tlsf_allocator::slot tlsf_allocator::mapping(vk::DeviceSize size) {
+        if ( size < min_block ) {
+            return { 0, uint32_t(size >> (min_bits - sl_bits)) };
+        }
+
+        const auto f { uint32_t(std::bit_width(size)) - 1 };
+        return { f - min_bits + 1, uint32_t(size >> (f - sl_bits)) - sl_count };
+    }
+
+    vk::DeviceSize tlsf_allocator::round_up(vk::DeviceSize size) {
+        const auto f {
+            std::max(uint32_t(std::bit_width(size)), min_bits + 1) - 1
+        };
+        const auto step { vk::DeviceSize(1) << (f - sl_bits) };
+        return (size + step - 1) & ~(step - 1);
+    }
+
+    tlsf_allocator::suballoc* tlsf_allocator::new_block(heap& h) {
+        if ( h.spare.empty() ) return &h.blocks.emplace_back();
+
+        auto b { h.spare.back() };
+        h.spare.pop_back();
+        *b = {};
+        return b;
+    }
+
+    void tlsf_allocator::insert_free(heap& h, suballoc* b) {
+        const auto [fl, sl] { mapping(b->size) };
+        auto& head { h.free_lists[fl * sl_count + sl] };
+
+        b->free      = true;
+        b->prev_free = nullptr;
+        b->next_free = head;
+        if ( head ) head->prev_free = b;
+        head = b;
+
+        h.fl_bitmap |= 1u << fl;
+        h.sl_bitmap[fl] |= 1u << sl;
+    }
+
+    void tlsf_allocator::remove_free(heap& h, suballoc* b) {
+        const auto [fl, sl] { mapping(b->size) };
+        auto& head { h.free_lists[fl * sl_count + sl] };
+
+        if ( b->prev_free ) b->prev_free->next_free = b->next_free;
+        if ( b->next_free ) b->next_free->prev_free = b->prev_free;
+        if ( head == b ) head = b->next_free;
+
+        b->free      = false;
+        b->prev_free = nullptr;
+        b->next_free = nullptr;
+
+        if ( head ) return;
+
+        h.sl_bitmap[fl] &= ~(1u << sl);
+        if ( h.sl_bitmap[fl] == 0 ) h.fl_bitmap &= ~(1u << fl);
+    }
+
+    tlsf_allocator::suballoc* tlsf_allocator::take_free(heap&          h,
+                                                        vk::DeviceSize size) {
+        auto [fl, sl] { mapping(round_up(size)) };
+        if ( fl >= fl_count ) return nullptr;
+
+        // a large enough list in the same power of two, else the first
+        // non-empty one of a larger power
+        auto sl_map { h.sl_bitmap[fl] & (~0u << sl) };
+        if ( sl_map == 0 ) {
+            const auto fl_map {
+                fl + 1 < fl_count ? h.fl_bitmap & (~0u << (fl + 1)) : 0u
+            };
+            if ( fl_map == 0 ) return nullptr;
+
+            fl     = uint32_t(std::countr_zero(fl_map));
+            sl_map = h.sl_bitmap[fl];
+        }
+        sl = uint32_t(std::countr_zero(sl_map));
+
+        auto b { h.free_lists[fl * sl_count + sl] };
+        remove_free(h, b);
+        return b;
+    }
+
+    void tlsf_allocator::split(heap& h, suballoc* b, vk::DeviceSize at) {
+        auto back { new_block(h) };
+
+        back->pool      = b->pool;
+        back->mem_inx   = b->mem_inx;
+        back->offset    = b->offset + at;
+        back->size      = b->size - at;
+        back->prev_phys = b;
+        back->next_phys = b->next_phys;
+
+        if ( b->next_phys ) b->next_phys->prev_phys = back;
+        b->next_phys = back;
+        b->size      = at;
+
+        insert_free(h, back);
+    }
+
+    void tlsf_allocator::add_pool(heap&          h,
+                                  uint32_t       mem_inx,
+                                  vk::DeviceSize min_size) {
+        using namespace units::literals;
+
+        // twice the size of the previous pool, or more if that is too small
+        vk::DeviceSize capacity {
+            h.pools.empty() ? 16_mb : h.pools.back().capacity * 2
+        };
+        while ( capacity < min_size ) {
+            capacity *= 2;
+        }
+
+        auto& pool { h.pools.emplace_back(capacity, mem_inx) };
+
+        // clang-format off
+        potato::graphics::set_debug_name(
+          pool.memory,
+          internal::device,
+          std::format("TLSF pool [mem_inx {} pool_inx {}]", mem_inx, h.pools.size() - 1));
+        // clang-format on
+
+        auto b { new_block(h) };
+        b->pool    = &pool;
+        b->mem_inx = mem_inx;
+        b->size    = capacity;
+        insert_free(h, b);
+    }
+
+    tlsf_allocator::suballoc_t*
+    tlsf_allocator::allocate(const vk::MemoryRequirements&  mem_req,
+                             const vk::MemoryPropertyFlags& mem_flags) {
+        const auto mem_inx {
+            find_mem_type(mem_flags, mem_req.memoryTypeBits)
+        };
+        auto& h { heaps[mem_inx] };
+
+        // enough for the request wherever the block starts
+        const auto alignment {
+            std::max<vk::DeviceSize>(mem_req.alignment, 1)
+        };
+        const auto needed { mem_req.size + alignment - 1 };
+
+        auto b { take_free(h, needed) };
+        if ( !b ) {
+            add_pool(h, mem_inx, needed);
+            b = take_free(h, needed);
+        }
+        if ( !b ) throw std::runtime_error("Allocation failed\n");
+
+        // the front that is only there for alignment goes back as a block
+        // of its own
+        if ( const auto pad { align(b->offset, alignment) - b->offset }; pad ) {
+            split(h, b, pad);
+
+            const auto front { b };
+            b = b->next_phys;
+            remove_free(h, b);
+            insert_free(h, front);
+        }
+
+        if ( b->size > mem_req.size ) split(h, b, mem_req.size);
+
+        return b;
+    }
+
+    void tlsf_allocator::free(suballoc_t* sub) {
+        auto& h { heaps[sub->mem_inx] };
+
+        // neighbours are merged right away, so neither of them has a free
+        // neighbour besides sub
+        if ( auto prev { sub->prev_phys }; prev && prev->free ) {
+            remove_free(h, prev);
+            prev->size += sub->size;
+            prev->next_phys = sub->next_phys;
+            if ( sub->next_phys ) sub->next_phys->prev_phys = prev;
+
+            h.spare.push_back(sub);
+            sub = prev;
+        }
+
+        if ( auto next { sub->next_phys }; next && next->free ) {
+            remove_free(h, next);
+            sub->size += next->size;
+            sub->next_phys = next->next_phys;
+            if ( next->next_phys ) next->next_phys->prev_phys = sub;
+
+            h.spare.push_back(next);
+        }
+
+        insert_free(h, sub);
+    }
+
+    vk::DeviceMemory tlsf_allocator::suballoc::memory() const {
+        return pool->memory;
+    }
+
+    void tlsf_allocator::_free_pool() {
+        for ( auto& h : heaps ) {
+            for ( auto& pool : h.pools ) {
+                internal::device.free(pool.memory);
+            }
+            h = {};
+        }
+    }
+
+}  // namespace vma
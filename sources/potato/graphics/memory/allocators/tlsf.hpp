@@ -0,0 +1,113 @@
+#ifndef POTATO_GRAPHICS_MEMORY_ALLOCATOR_TLSF_HPP
+#define POTATO_GRAPHICS_MEMORY_ALLOCATOR_TLSF_HPP
+
+#include "../internal.hpp"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace vma {
+
+    // Two-level segregated fit allocator. Free blocks of every pool of a
+    // memory type sit in one table of free lists, indexed first by the
+    // power of two of their size and then by one of sl_count equal slices
+    // of that power. A bitmap per level tells which lists hold anything, so
+    // finding a block that fits is two bit scans, whatever the number of
+    // pools or allocations. Freed blocks merge with their free neighbours
+    // right away, which is O(1) too, as every block knows the blocks next
+    // to it in its pool. Pools are only handed back to the device by
+    // _free_pool().
+    //
+    // Pick it per resource through vma::memory<vma::tlsf_allocator>.
+    class tlsf_allocator {
+      public:
+        struct suballoc {
+            internal::pool* pool {};
+            vk::DeviceSize  offset {};
+            vk::DeviceSize  size {};
+            bool            free { false };
+
+            // neighbours in the pool, by offset
+            suballoc* prev_phys {};
+            suballoc* next_phys {};
+
+            // neighbours in the free list, while free
+            suballoc* prev_free {};
+            suballoc* next_free {};
+
+            // the memory type the block belongs to
+            uint32_t mem_inx {};
+
+            vk::DeviceMemory memory() const;
+        };
+
+      private:
+        static constexpr uint32_t sl_bits  = 5;
+        static constexpr uint32_t sl_count = 1u << sl_bits;
+
+        // blocks smaller than this share the first level, in sl_count
+        // slices of min_block / sl_count bytes
+        static constexpr uint32_t min_bits  = 8;
+        static constexpr uint64_t min_block = uint64_t(1) << min_bits;
+
+        // enough for pools of up to 2^(min_bits + fl_count - 1) bytes
+        static constexpr uint32_t fl_count = 32;
+
+        // free lists and pools of one memory type
+        struct heap {
+            uint32_t                                   fl_bitmap {};
+            std::array<uint32_t, fl_count>             sl_bitmap {};
+            std::array<suballoc*, fl_count * sl_count> free_lists {};
+
+            // blocks are never moved, so suballoc pointers stay valid.
+            // Unused ones are kept in `spare`
+            std::deque<internal::pool> pools {};
+            std::deque<suballoc>       blocks {};
+            std::vector<suballoc*>     spare {};
+        };
+
+        static std::array<heap, VK_MAX_MEMORY_TYPES> heaps;
+
+        struct slot {
+            uint32_t fl {};
+            uint32_t sl {};
+        };
+
+        // the list a free block of `size` bytes goes to
+        static slot mapping(vk::DeviceSize size);
+
+        // `size` rounded up to the smallest block of some list, every block
+        // in that list and the ones after it is at least that large
+        static vk::DeviceSize round_up(vk::DeviceSize size);
+
+        static suballoc* new_block(heap&);
+
+        static void insert_free(heap&, suballoc*);
+        static void remove_free(heap&, suballoc*);
+
+        // removes and returns a free block of at least `size` bytes, or
+        // nullptr if there is none
+        static suballoc* take_free(heap&, vk::DeviceSize size);
+
+        // cuts `b` at `at` bytes, the back becomes a free block of its own
+        static void split(heap&, suballoc* b, vk::DeviceSize at);
+
+        static void add_pool(heap&, uint32_t mem_inx, vk::DeviceSize min_size);
+
+      public:
+        using suballoc_t = suballoc;
+
+        static void _free_pool();
+
+        tlsf_allocator() = default;
+
+        [[nodiscard]] suballoc_t* allocate(const vk::MemoryRequirements&,
+                                           const vk::MemoryPropertyFlags&);
+        void                      free(suballoc_t*);
+    };
+
+}  // namespace vma
+
+#endif
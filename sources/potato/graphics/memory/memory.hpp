@@ -6,7 +6,9 @@
 
 namespace vma {
 
+    class buddy_allocator;
     class linear_allocator;
+    class tlsf_allocator;
 
     template<typename sub_t>
     concept allocator_suballoc = requires(sub_t a) {
@@ -28,6 +30,10 @@ namespace vma {
         // clang-format on
     };
 
+    // Allocates from T's pools, the linear allocator unless asked
+    // otherwise. memory<tlsf_allocator> takes constant time whatever is
+    // allocated already, resources of power of two sizes, like render
+    // targets, can use memory<buddy_allocator>
     template<gpu_allocator T = linear_allocator>
     class memory {
       private:
@@ -1,12 +1,16 @@
 #ifndef POTATO_GRAPHICS_MEMORY_HPP
 #define POTATO_GRAPHICS_MEMORY_HPP
 
+#include "allocators/buddy.hpp"
 #include "allocators/linear.hpp"
+#include "allocators/tlsf.hpp"
 #include "memory.hpp"
 
 #include <tuple>
 
-using all_allocators = std::tuple<vma::linear_allocator>;
+using all_allocators = std::tuple<vma::linear_allocator,
+                                  vma::tlsf_allocator,
+                                  vma::buddy_allocator>;
 
 namespace vma {
     bool init(vk::PhysicalDevice, vk::Device);
@@ -1,6 +1,8 @@
 #ifndef POTATO_RENDER_CAMERA
 #define POTATO_RENDER_CAMERA
 
+#include <core/geometry.hpp>
+
 namespace testapp {
     class camera {
       public:
@@ -32,6 +34,13 @@ namespace testapp {
             return viewMatrix;
         }
 
+        // What the camera sees, in world space, from
+        // getProjection() * getView()
+        potato::math::frustum getFrustum() const {
+            return potato::math::frustum::from_matrix(projectionMatrix
+                                                      * viewMatrix);
+        }
+
       private:
         glm::mat4 projectionMatrix { 1.f };
         glm::mat4 viewMatrix { 1.f };
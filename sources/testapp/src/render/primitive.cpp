@@ -39,6 +39,13 @@ namespace testapp {
 
         assert(vertex_count >= 3 && "Vertex count must be at least 3");
 
+        potato::math::aabb extent { mesh[0].position, mesh[0].position };
+        for ( const auto& v : mesh ) {
+            extent = potato::math::aabb::merge(extent,
+                                               { v.position, v.position });
+        }
+        local_bounds = extent.bounding_sphere();
+
         vk::DeviceSize buffer_size = sizeof(mesh[0]) * vertex_count;
 
         constexpr auto host_visible_coherent {
@@ -1,6 +1,8 @@
 #ifndef POTATO_VERTEX_HPP
 #define POTATO_VERTEX_HPP
 
+#include "core/geometry.hpp"
+#include "core/trs.hpp"
 #include "graphics/memory/vma.hpp"
 
 #include <vector>
@@ -30,14 +32,11 @@ namespace testapp {
         glm::quat rotation {};
 
         void euler_rotate(glm::vec3 euler_angles) {
-            rotation = glm::toQuat(
-              glm::yawPitchRoll(euler_angles.y, euler_angles.x, euler_angles.z));
+            rotation = potato::math::euler_to_quat(euler_angles);
         }
 
         glm::mat4 mat4() const {
-            return glm::translate(glm::mat4 { 1.f }, translation)
-                 * glm::toMat4(rotation)
-                 * glm::scale(glm::mat4 { 1.0f }, scale);
+            return potato::math::trs_to_mat4(translation, rotation, scale);
         }
     };
 
@@ -52,6 +51,9 @@ namespace testapp {
         vk::Buffer        vertex_bufer {};
         vma::memory<>     vertex_device_mem {};
 
+        // around every vertex, in model space
+        potato::math::sphere local_bounds {};
+
       public:
         model_transform transform {};
 
@@ -64,6 +66,10 @@ namespace testapp {
         model(model&&) = default;
         model& operator=(model&&) = default;
 
+        const potato::math::sphere& bounds() const {
+            return local_bounds;
+        }
+
         void bind(const vk::CommandBuffer& cmdbuffer) const;
         void draw(const vk::CommandBuffer& cmdbuffer) const;
     };
@@ -64,11 +64,41 @@ namespace testapp {
 
         auto projectionView = cam.getProjection() * cam.getView();
 
+        // only what the camera sees is drawn
+        m_spheres.resize(objects.size());
+        m_visible.resize(objects.size());
+
+        for ( size_t i = 0; i < objects.size(); ++i ) {
+            const auto& obj { objects[i] };
+            const auto& t { obj.transform };
+            m_spheres.set(i,
+                          obj.bounds().transformed(t.translation,
+                                                   t.rotation,
+                                                   t.scale));
+        }
+
+        const auto visible { potato::math::cull_spheres(
+          cam.getFrustum(), m_spheres.view(), m_visible) };
+
+        // build the visible objects' clip space matrices in one batch
+        m_transforms.resize(visible);
+        m_clip_matrices.resize(visible);
+
+        for ( size_t k = 0; k < visible; ++k ) {
+            const auto& t { objects[m_visible[k]].transform };
+            m_transforms.set(k, t.translation, t.rotation, t.scale);
+        }
+
+        potato::math::trs_to_mat4(projectionView,
+                                  m_transforms.view(),
+                                  m_clip_matrices);
+
         m_pipeline.bind(cmd_buffer);
 
-        for ( auto& obj : objects ) {
+        for ( size_t k = 0; k < visible; ++k ) {
+            const auto& obj { objects[m_visible[k]] };
 
-            push.transform = projectionView * obj.transform.mat4();
+            push.transform = m_clip_matrices[k];
 
             cmd_buffer.pushConstants(m_pipeline.get_layout(),
                                      shader_and_frag,
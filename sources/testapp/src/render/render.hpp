@@ -4,7 +4,10 @@
 #include "camera.hpp"
 #include "primitive.hpp"
 
+#include <core/culling.hpp>
+#include <core/trs.hpp>
 #include <graphics/pipeline.hpp>
+#include <vector>
 
 namespace testapp {
 
@@ -12,11 +15,18 @@ namespace testapp {
       private:
         potato::graphics::pipeline m_pipeline;
 
+        // per-frame scratch for render_objects, kept to avoid reallocating
+        potato::math::sphere_buffer m_spheres {};
+        std::vector<uint32_t>       m_visible {};
+        potato::math::trs_buffer    m_transforms {};
+        std::vector<glm::mat4>      m_clip_matrices {};
+
         void create_pipeline(const vk::Device&, const vk::RenderPass&);
 
       public:
         render_system(const vk::Device&, const vk::RenderPass&);
 
+        // Draws the objects whose bounds are in view of the camera
         void render_objects(const vk::CommandBuffer&,
                             const std::vector<testapp::model>&,
                             const camera&);